@@ -0,0 +1,387 @@
+#include "./avl.h"
+
+
+AvlTree* avl_new(size_t capacity) {
+    AvlTree* tree = (AvlTree*)malloc(sizeof(AvlTree));
+    tree->root = NULL;
+    tree->free_nodes = NULL;
+    tree->slabs = NULL;
+    tree->slab_used = 0;
+    tree->capacity = capacity ?
+        capacity : 1;
+    tree->count = 0;
+    return tree;
+}
+
+AvlNode* avl_node_new(AvlTree* tree) {
+    tree->count++;
+
+    AvlNode* node = tree->free_nodes;
+    if (node) {
+        tree->free_nodes = node->left;
+        return node;
+    }
+
+    if (tree->slabs == NULL || tree->slab_used == tree->slabs->count) {
+        size_t count = tree->slabs ?
+            tree->slabs->count * 2 : tree->capacity;
+        AvlSlab* slab = (AvlSlab*)malloc(sizeof(AvlSlab) + count * sizeof(AvlNode));
+        if (slab == NULL) {
+            tree->count--;
+            return NULL;
+        }
+        slab->next = tree->slabs;
+        slab->count = count;
+        tree->slabs = slab;
+        tree->slab_used = 0;
+    }
+
+    return &tree->slabs->nodes[tree->slab_used++];
+}
+
+void avl_node_release(AvlTree* tree, AvlNode* node) {
+    tree->count--;
+    node->left = tree->free_nodes;
+    tree->free_nodes = node;
+}
+
+void avl_drop(AvlTree* tree) {
+    AvlSlab* slab = tree->slabs;
+    while (slab) {
+        AvlSlab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(tree);
+}
+
+int avlnode_get_height(AvlNode* node) {
+    return node ?
+        node->height : 0;
+}
+
+int avlnode_get_balance(AvlNode* node) {
+    return node ?
+        avlnode_get_height(node->left) - avlnode_get_height(node->right) : 0;
+}
+
+void avlnode_update_height(AvlNode* node) {
+    node->height =
+        1 +
+        (avlnode_get_height(node->left) > avlnode_get_height(node->right) ?
+            avlnode_get_height(node->left) : avlnode_get_height(node->right)
+        );
+}
+
+AvlNode* avlnode_rotate_left(AvlNode* node) {
+    AvlNode* temp = node->right;
+    node->right = temp->left;
+    temp->left = node;
+    avlnode_update_height(node);
+    avlnode_update_height(temp);
+    return temp;
+}
+
+AvlNode* avlnode_rotate_right(AvlNode* node) {
+    AvlNode* temp = node->left;
+    node->left = temp->right;
+    temp->right = node;
+    avlnode_update_height(node);
+    avlnode_update_height(temp);
+    return temp;
+}
+
+AvlNode* avlnode_rebalance(AvlNode* node) {
+    avlnode_update_height(node);
+    int balance = avlnode_get_balance(node);
+    if (balance > 1) {
+        if (
+            avlnode_get_height(node->left->left) >=
+            avlnode_get_height(node->left->right)
+        ) {
+            return avlnode_rotate_right(node);
+        }
+        else {
+            node->left = avlnode_rotate_left(node->left);
+            return avlnode_rotate_right(node);
+        }
+    }
+    if (balance < -1) {
+        if (
+            avlnode_get_height(node->right->right) >=
+            avlnode_get_height(node->right->left)
+        ) {
+            return avlnode_rotate_left(node);
+        }
+        else {
+            node->right = avlnode_rotate_right(node->right);
+            return avlnode_rotate_left(node);
+        }
+    }
+    return node;
+}
+
+AvlNode* avlnode_insert(AvlTree* tree, AvlNode** node, void* key, size_t size) {
+    AvlNode* inserted;
+
+    if (*node == NULL) {
+        *node = avl_node_new(tree);
+        if (*node == NULL)
+            return NULL;
+        (*node)->key = key;
+        (*node)->size = size;
+        (*node)->left = NULL;
+        (*node)->right = NULL;
+        (*node)->height = 1;
+        (*node)->kind = 0;
+        (*node)->owner = NULL;
+        return *node;
+    }
+    else if (key < (*node)->key) {
+        inserted = avlnode_insert(tree, &((*node)->left), key, size);
+    }
+    else if (key > (*node)->key) {
+        inserted = avlnode_insert(tree, &((*node)->right), key, size);
+    }
+    else {
+        (*node)->size = size;
+        return *node;
+    }
+
+    *node = avlnode_rebalance(*node);
+    return inserted;
+}
+
+AvlNode* avl_insert(AvlTree* tree, void* key, size_t size) {
+    return avlnode_insert(tree, &(tree->root), key, size);
+}
+
+AvlNode* avl_find(AvlTree* tree, void* key) {
+    AvlNode* node = tree->root;
+    while (node && node->key != key) {
+        node = key < node->key ?
+            node->left : node->right;
+    }
+    return node;
+}
+
+AvlNode* avl_floor(AvlTree* tree, void* key) {
+    AvlNode* node = tree->root;
+    AvlNode* floor = NULL;
+    while (node) {
+        if (node->key == key)
+            return node;
+
+        if (node->key < key) {
+            floor = node;
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+    return floor;
+}
+
+AvlNode** avlnode_flatten(AvlNode* node, AvlNode** out) {
+    if (node) {
+        out = avlnode_flatten(node->left, out);
+        *out++ = node;
+        out = avlnode_flatten(node->right, out);
+    }
+    return out;
+}
+
+AvlNode* avlnode_build(AvlNode** nodes, size_t count) {
+    if (count == 0)
+        return NULL;
+
+    size_t middle = count / 2;
+    AvlNode* node = nodes[middle];
+    node->left = avlnode_build(nodes, middle);
+    node->right = avlnode_build(nodes + middle + 1, count - middle - 1);
+    avlnode_update_height(node);
+    return node;
+}
+
+int avlnode_compare_keys(const void* a, const void* b) {
+    const void* ka = (*(AvlNode* const*)a)->key;
+    const void* kb = (*(AvlNode* const*)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+size_t avl_insert_many(AvlTree* tree, void* const* keys, const size_t* sizes, size_t count, void* owner) {
+    if (count == 0)
+        return 0;
+
+    size_t existing = tree->count;
+    size_t total = existing + count;
+    size_t depth = 1;
+    while ((1ul << depth) < total)
+        depth++;
+
+    // Small batches, or no memory for the rebuild, go one by one
+    AvlNode** nodes = NULL;
+    AvlNode** merged = NULL;
+    size_t created = 0;
+    if (count * depth >= total) {
+        nodes = (AvlNode**)malloc(total * sizeof(AvlNode*));
+        merged = (AvlNode**)malloc(total * sizeof(AvlNode*));
+    }
+
+    // New nodes go after the existing ones, sorted separately, then merged
+    AvlNode** added = nodes ?
+        nodes + existing : NULL;
+    if (nodes && merged) {
+        while (created < count && (added[created] = avl_node_new(tree)) != NULL)
+            created++;
+    }
+    if (created < count) {
+        for (size_t i = 0; i < created; i++)
+            avl_node_release(tree, added[i]);
+        free(nodes);
+        free(merged);
+        for (size_t i = 0; i < count; i++) {
+            AvlNode* node = avl_insert(tree, keys[i], sizes[i]);
+            if (node == NULL)
+                return i;
+            node->owner = owner;
+        }
+        return count;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        added[i]->key = keys[i];
+        added[i]->size = sizes[i];
+        added[i]->kind = 0;
+        added[i]->owner = owner;
+    }
+    qsort(added, count, sizeof(AvlNode*), avlnode_compare_keys);
+
+    avlnode_flatten(tree->root, nodes);
+    size_t i = 0, j = 0, k = 0;
+    while (i < existing || j < count) {
+        AvlNode* next;
+        if (j == count || (i < existing && nodes[i]->key <= added[j]->key)) {
+            next = nodes[i++];
+        }
+        else {
+            next = added[j++];
+        }
+
+        // Duplicate keys keep a single node holding the latest size
+        if (k > 0 && merged[k - 1]->key == next->key) {
+            merged[k - 1]->size = next->size;
+            avl_node_release(tree, next);
+        }
+        else {
+            merged[k++] = next;
+        }
+    }
+
+    tree->root = avlnode_build(merged, k);
+    free(merged);
+    free(nodes);
+    return count;
+}
+
+int avlnode_remove(AvlTree* tree, AvlNode** node, void* key, AvlNode* removed) {
+    int kind;
+
+    if (*node == NULL)
+        return -1;
+
+    if (key < (*node)->key) {
+        kind = avlnode_remove(tree, &((*node)->left), key, removed);
+    }
+    else if (key > (*node)->key) {
+        kind = avlnode_remove(tree, &((*node)->right), key, removed);
+    }
+    else {
+        kind = (*node)->kind;
+        if (removed)
+            *removed = **node;
+        if ((*node)->left == NULL) {
+            AvlNode* temp = (*node)->right;
+            avl_node_release(tree, *node);
+            *node = temp;
+        }
+        else if ((*node)->right == NULL) {
+            AvlNode* temp = (*node)->left;
+            avl_node_release(tree, *node);
+            *node = temp;
+        }
+        else {
+            AvlNode* temp = (*node)->right;
+            while (temp->left != NULL) {
+                temp = temp->left;
+            }
+            (*node)->key = temp->key;
+            (*node)->size = temp->size;
+            (*node)->kind = temp->kind;
+            (*node)->owner = temp->owner;
+            avlnode_remove(tree, &((*node)->right), temp->key, NULL);
+        }
+    }
+
+    if (*node != NULL) {
+        *node = avlnode_rebalance(*node);
+    }
+    return kind;
+}
+
+int avl_remove(AvlTree* tree, void* key, AvlNode* removed) {
+    return avlnode_remove(tree, &(tree->root), key, removed);
+}
+
+void avlnode_iter(AvlNode* node, void (*func)(void*)) {
+    if (node) {
+        avlnode_iter(node->left, func);
+        func(node->key);
+        avlnode_iter(node->right, func);
+    }
+}
+
+void avlnode_iter_destroy(AvlNode* node, void (*func)(AvlNode*)) {
+    if (node) {
+        avlnode_iter_destroy(node->left, func);
+        avlnode_iter_destroy(node->right, func);
+        func(node);
+    }
+}
+
+void avlnode_iter_range(AvlNode* node, void* lo, void* hi, void (*func)(void*, size_t, void*), void* ctx) {
+    if (node) {
+        if (node->key > lo)
+            avlnode_iter_range(node->left, lo, hi, func, ctx);
+        if (node->key >= lo && node->key < hi)
+            func(node->key, node->size, ctx);
+        if (node->key < hi)
+            avlnode_iter_range(node->right, lo, hi, func, ctx);
+    }
+}
+
+void avlnode_iter_nodes(AvlNode* node, void (*func)(AvlNode*, void*), void* ctx) {
+    if (node) {
+        avlnode_iter_nodes(node->left, func, ctx);
+        func(node, ctx);
+        avlnode_iter_nodes(node->right, func, ctx);
+    }
+}
+
+void avl_iter_nodes(AvlTree* tree, void (*func)(AvlNode*, void*), void* ctx) {
+    avlnode_iter_nodes(tree->root, func, ctx);
+}
+
+void avl_iter_range(AvlTree* tree, void* lo, void* hi, void (*func)(void*, size_t, void*), void* ctx) {
+    avlnode_iter_range(tree->root, lo, hi, func, ctx);
+}
+
+void avl_iter(AvlTree* tree, void (*func)(void*)) {
+    avlnode_iter(tree->root, func);
+}
+
+void avl_iter_destroy(AvlTree* tree, void (*func)(AvlNode*)) {
+    avlnode_iter_destroy(tree->root, func);
+    avl_drop(tree);
+}
@@ -6,60 +6,82 @@
  * @struct AvlNode
  * @brief A node in the AVL tree.
  *
- * Each node has a key, left and right child pointers, and a height.
- * Size: 32 bytes
+ * Each node has a key, the size of the block it points to, left and right
+ * child pointers, a height, and the kind and owner of the block, left to the
+ * caller (0 and NULL for new nodes).
+ * Size: 48 bytes
  */
 typedef struct AvlNode {
     void* key;
+    size_t size;
     struct AvlNode* left;
     struct AvlNode* right;
     int height;
+    int kind;
+    void* owner;
 } AvlNode;
 
+/**
+ * @struct AvlSlab
+ * @brief A contiguous block of AVL nodes.
+ *
+ * Nodes are carved from slabs instead of being allocated one by one, and
+ * removed nodes are kept on a freelist for the next insertion.
+ */
+typedef struct AvlSlab {
+    struct AvlSlab* next;
+    size_t count;
+    AvlNode nodes[];
+} AvlSlab;
+
 /**
  * @struct AvlTree
  * @brief The AVL tree data structure.
  *
- * The AVL tree is represented by a single node, the root.
- * Size: 8 bytes
+ * The AVL tree is represented by its root, along with the slabs its nodes
+ * live in and the freelist of unused nodes (linked through `left`). `count`
+ * is the number of nodes in use.
+ * Size: 48 bytes
  */
 typedef struct {
     AvlNode* root;
+    AvlNode* free_nodes;
+    AvlSlab* slabs;
+    size_t slab_used;
+    size_t capacity;
+    size_t count;
 } AvlTree;
 
 /**
  * @brief Creates a new AVL tree.
  *
+ * @param capacity The number of nodes to preallocate, later slabs double it.
  * @return A pointer to the new AVL tree.
  */
-AvlTree* avl_new() {
-    AvlTree* tree = (AvlTree*)malloc(sizeof(AvlTree));
-    tree->root = NULL;
-    return tree;
-}
+AvlTree* avl_new(size_t capacity);
+
+/**
+ * @brief Takes a node from the tree's slabs. O(1)
+ *
+ * @param tree The tree the node belongs to.
+ * @return An uninitialized node, or NULL if a slab can't be allocated.
+ */
+AvlNode* avl_node_new(AvlTree* tree);
 
 /**
- * @brief Drops an AVL node and all its children.
+ * @brief Gives a node back to the tree's freelist. O(1)
  *
- * @param node The node to drop.
+ * @param tree The tree the node belongs to.
+ * @param node The node to release.
  */
-void avlnode_drop(AvlNode* node) {
-    if (node) {
-        avlnode_drop(node->left);
-        avlnode_drop(node->right);
-        free(node);
-    }
-}
+void avl_node_release(AvlTree* tree, AvlNode* node);
 
 /**
  * @brief Drops an AVL tree.
  *
  * @param tree The tree to drop.
  */
-void avl_drop(AvlTree* tree) {
-    avlnode_drop(tree->root);
-    free(tree);
-}
+void avl_drop(AvlTree* tree);
 
 /**
  * @brief Gets the height of an AVL node. O(1)
@@ -67,10 +89,7 @@ void avl_drop(AvlTree* tree) {
  * @param node The node to get the height of.
  * @return The height of the node.
  */
-int avlnode_get_height(AvlNode* node) {
-    return node ?
-        node->height : 0;
-}
+int avlnode_get_height(AvlNode* node);
 
 /**
  * @brief Gets the balance factor of an AVL node. O(1)
@@ -78,23 +97,14 @@ int avlnode_get_height(AvlNode* node) {
  * @param node The node to get the balance factor of.
  * @return The balance factor of the node.
  */
-int avlnode_get_balance(AvlNode* node) {
-    return node ?
-        avlnode_get_height(node->left) - avlnode_get_height(node->right) : 0;
-}
+int avlnode_get_balance(AvlNode* node);
 
 /**
  * @brief Updates the height of an AVL node. O(1)
  *
  * @param node The node to update the height of.
  */
-void avlnode_update_height(AvlNode* node) {
-    node->height =
-        1 +
-        (avlnode_get_height(node->left) > avlnode_get_height(node->right) ?
-            avlnode_get_height(node->left) : avlnode_get_height(node->right)
-        );
-}
+void avlnode_update_height(AvlNode* node);
 
 /**
  * @brief Rotates an AVL node to the left. O(1)
@@ -102,14 +112,7 @@ void avlnode_update_height(AvlNode* node) {
  * @param node The node to rotate.
  * @return The new root node after rotation.
  */
-AvlNode* avlnode_rotate_left(AvlNode* node) {
-    AvlNode* temp = node->right;
-    node->right = temp->left;
-    temp->left = node;
-    avlnode_update_height(node);
-    avlnode_update_height(temp);
-    return temp;
-}
+AvlNode* avlnode_rotate_left(AvlNode* node);
 
 /**
  * @brief Rotates an AVL node to the right. O(1)
@@ -117,14 +120,7 @@ AvlNode* avlnode_rotate_left(AvlNode* node) {
  * @param node The node to rotate.
  * @return The new root node after rotation.
  */
-AvlNode* avlnode_rotate_right(AvlNode* node) {
-    AvlNode* temp = node->left;
-    node->left = temp->right;
-    temp->right = node;
-    avlnode_update_height(node);
-    avlnode_update_height(temp);
-    return temp;
-}
+AvlNode* avlnode_rotate_right(AvlNode* node);
 
 /**
  * @brief Rebalances an AVL node. 0(1)
@@ -132,121 +128,110 @@ AvlNode* avlnode_rotate_right(AvlNode* node) {
  * @param node The node to rebalance.
  * @return The new root node after rebalancing.
  */
-AvlNode* avlnode_rebalance(AvlNode* node) {
-    avlnode_update_height(node);
-    int balance = avlnode_get_balance(node);
-    if (balance > 1) {
-        if (
-            avlnode_get_height(node->left->left) >=
-            avlnode_get_height(node->left->right)
-        ) {
-            return avlnode_rotate_right(node);
-        }
-        else {
-            node->left = avlnode_rotate_left(node->left);
-            return avlnode_rotate_right(node);
-        }
-    }
-    if (balance < -1) {
-        if (
-            avlnode_get_height(node->right->right) >=
-            avlnode_get_height(node->right->left)
-        ) {
-            return avlnode_rotate_left(node);
-        }
-        else {
-            node->right = avlnode_rotate_right(node->right);
-            return avlnode_rotate_left(node);
-        }
-    }
-    return node;
-}
+AvlNode* avlnode_rebalance(AvlNode* node);
 
 /**
  * @brief Inserts a new key into the AVL tree. O(log2(n))
  *
+ * If the key is already present, its size is updated.
+ *
+ * @param tree The tree the node belongs to.
  * @param node The node to insert the key into.
  * @param key The key to insert.
+ * @param size The size of the block pointed to by the key.
+ * @return The node holding the key, or NULL if no node can be allocated.
  */
-void avlnode_insert(AvlNode** node, void* key) {
-    if (*node == NULL) {
-        *node = (AvlNode*)malloc(sizeof(AvlNode));
-        (*node)->key = key;
-        (*node)->left = NULL;
-        (*node)->right = NULL;
-        (*node)->height = 1;
-    }
-    else if (key < (*node)->key) {
-        avlnode_insert(&((*node)->left), key);
-    }
-    else if (key > (*node)->key) {
-        avlnode_insert(&((*node)->right), key);
-    }
-
-    *node = avlnode_rebalance(*node);
-}
+AvlNode* avlnode_insert(AvlTree* tree, AvlNode** node, void* key, size_t size);
 
 /**
  * @brief Inserts a new key into the AVL tree. O(log2(n))
  *
  * @param tree The tree to insert the key into.
  * @param key The key to insert.
+ * @param size The size of the block pointed to by the key.
+ * @return The node holding the key, or NULL if no node can be allocated.
+ */
+AvlNode* avl_insert(AvlTree* tree, void* key, size_t size);
+
+/**
+ * @brief Finds the node holding a key. O(log2(n))
+ *
+ * @param tree The tree to search.
+ * @param key The key to find.
+ * @return The node holding the key, or NULL if the key is not in the tree.
+ */
+AvlNode* avl_find(AvlTree* tree, void* key);
+
+/**
+ * @brief Finds the node with the greatest key lower than or equal to a key. O(log2(n))
+ *
+ * @param tree The tree to search.
+ * @param key The key to look up.
+ * @return The predecessor node, or NULL if every key is greater.
+ */
+AvlNode* avl_floor(AvlTree* tree, void* key);
+
+/**
+ * @brief Writes the nodes of an AVL subtree in key order. O(n)
+ *
+ * @param node The root of the subtree.
+ * @param out The array receiving the nodes.
+ * @return The position following the last written node.
+ */
+AvlNode** avlnode_flatten(AvlNode* node, AvlNode** out);
+
+/**
+ * @brief Builds a perfectly balanced AVL subtree from nodes in key order. O(n)
+ *
+ * @param nodes The nodes, sorted by key.
+ * @param count The number of nodes.
+ * @return The root of the new subtree.
+ */
+AvlNode* avlnode_build(AvlNode** nodes, size_t count);
+
+/**
+ * @brief Orders two AVL nodes by key, for qsort.
  */
-void avl_insert(AvlTree* tree, void* key) {
-    avlnode_insert(&(tree->root), key);
-}
+int avlnode_compare_keys(const void* a, const void* b);
+
+/**
+ * @brief Inserts many keys into the AVL tree in one batch.
+ *
+ * Small batches are inserted one by one in O(k*log2(n+k)), as are batches
+ * the rebuild can't allocate memory for. Large batches are sorted and merged
+ * with the existing nodes, then the tree is rebuilt in O(n + k*log2(k))
+ * instead of rebalancing once per key.
+ *
+ * @param tree The tree to insert the keys into.
+ * @param keys The keys to insert.
+ * @param sizes The sizes of the blocks pointed to by the keys.
+ * @param count The number of keys.
+ * @param owner The owner of the new nodes.
+ * @return The number of keys inserted, count unless a node can't be
+ * allocated: the keys from there on are then left out.
+ */
+size_t avl_insert_many(AvlTree* tree, void* const* keys, const size_t* sizes, size_t count, void* owner);
 
 /**
  * @brief Removes a key from the AVL tree. O(log2(n))
  *
+ * @param tree The tree the node belongs to.
  * @param node The node to remove the key from.
  * @param key The key to remove.
+ * @param removed Receives a copy of the removed node, may be NULL.
+ * @return The kind of the removed node, or -1 if the key was not in the tree.
  */
-void avlnode_remove(AvlNode** node, void* key) {
-    if (*node == NULL)
-        return;
-    
-    if (key < (*node)->key) {
-        avlnode_remove(&((*node)->left), key);
-    }
-    else if (key > (*node)->key) {
-        avlnode_remove(&((*node)->right), key);
-    }
-    else {
-        if ((*node)->left == NULL) {
-            AvlNode* temp = (*node)->right;
-            free(*node);
-            *node = temp;
-        }
-        else if ((*node)->right == NULL) {
-            AvlNode* temp = (*node)->left;
-            free(*node);
-            *node = temp;
-        }
-        else {
-            AvlNode* temp = (*node)->right;
-            while (temp->left != NULL) {
-                temp = temp->left;
-            }
-            (*node)->key = temp->key;
-            avlnode_remove(&((*node)->right), temp->key);
-        }
-    }
-
-    if (*node != NULL) {
-        *node = avlnode_rebalance(*node);
-    }
-}
+int avlnode_remove(AvlTree* tree, AvlNode** node, void* key, AvlNode* removed);
 
 /**
  * @brief Removes a key from the AVL tree. O(log2(n))
  *
  * @param tree The tree to remove the key from.
  * @param key The key to remove.
+ * @param removed Receives a copy of the removed node, may be NULL.
+ * @return The kind of the removed node, or -1 if the key was not in the tree.
  */
-void avl_remove(AvlTree* tree, void* key) {
-    avlnode_remove(&(tree->root), key);
-}
+int avl_remove(AvlTree* tree, void* key, AvlNode* removed);
 
 /**
  * @brief Iterates over the keys in the AVL tree. O(n)
@@ -254,28 +239,55 @@ void avl_remove(AvlTree* tree, void* key) {
  * @param node The node to iterate over.
  * @param func The function to call for each key.
  */
-void avlnode_iter(AvlNode* node, void (*func)(void*)) {
-    if (node) {
-        avlnode_iter(node->left, func);
-        func(node->key);
-        avlnode_iter(node->right, func);
-    }
-}
+void avlnode_iter(AvlNode* node, void (*func)(void*));
 
 /**
- * @brief Iterates over the keys in the AVL tree, calls a function for each key, and then deletes the node. O(n)
+ * @brief Iterates over the keys in the AVL tree, calls a function for each node, and then deletes the node. O(n)
  *
  * @param node The node to iterate over.
- * @param func The function to call for each key.
+ * @param func The function to call for each node.
+ */
+void avlnode_iter_destroy(AvlNode* node, void (*func)(AvlNode*));
+
+/**
+ * @brief Iterates over the keys of an AVL subtree in [lo, hi), in order. O(log2(n) + k)
+ *
+ * @param node The node to iterate over.
+ * @param lo The lowest key to visit.
+ * @param hi The key after the last one to visit.
+ * @param func The function to call for each key, with its size.
+ * @param ctx Passed to `func`.
  */
-void avlnode_iter_destroy(AvlNode* node, void (*func)(void*)) {
-    if (node) {
-        avlnode_iter_destroy(node->left, func);
-        avlnode_iter_destroy(node->right, func);
-        func(node->key);
-        free(node);
-    }
-}
+void avlnode_iter_range(AvlNode* node, void* lo, void* hi, void (*func)(void*, size_t, void*), void* ctx);
+
+/**
+ * @brief Iterates over the nodes of an AVL subtree, in key order. O(n)
+ *
+ * @param node The node to iterate over.
+ * @param func The function to call for each node, which must not insert or remove keys.
+ * @param ctx Passed to `func`.
+ */
+void avlnode_iter_nodes(AvlNode* node, void (*func)(AvlNode*, void*), void* ctx);
+
+/**
+ * @brief Iterates over the nodes in the AVL tree, in key order. O(n)
+ *
+ * @param tree The tree to iterate over.
+ * @param func The function to call for each node, which must not insert or remove keys.
+ * @param ctx Passed to `func`.
+ */
+void avl_iter_nodes(AvlTree* tree, void (*func)(AvlNode*, void*), void* ctx);
+
+/**
+ * @brief Iterates over the keys of the AVL tree in [lo, hi), in order. O(log2(n) + k)
+ *
+ * @param tree The tree to iterate over.
+ * @param lo The lowest key to visit.
+ * @param hi The key after the last one to visit.
+ * @param func The function to call for each key, with its size.
+ * @param ctx Passed to `func`.
+ */
+void avl_iter_range(AvlTree* tree, void* lo, void* hi, void (*func)(void*, size_t, void*), void* ctx);
 
 /**
  * @brief Iterates over the keys in the AVL tree. O(n)
@@ -283,18 +295,13 @@ void avlnode_iter_destroy(AvlNode* node, void (*func)(void*)) {
  * @param tree The tree to iterate over.
  * @param func The function to call for each key.
  */
-void avl_iter(AvlTree* tree, void (*func)(void*)) {
-    avlnode_iter(tree->root, func);
-}
+void avl_iter(AvlTree* tree, void (*func)(void*));
 
 /**
- * @brief Iterates over the keys in the AVL tree, calls a function for each key, and then deletes the node. O(n)
+ * @brief Iterates over the keys in the AVL tree, calls a function for each node, and then deletes the node. O(n)
  *
  * @param tree The tree to iterate over.
- * @param func The function to call for each key.
+ * @param func The function to call for each node.
  */
-void avl_iter_destroy(AvlTree* tree, void (*func)(void*)) {
-    avlnode_iter_destroy(tree->root, func);
-    free(tree);
-}
+void avl_iter_destroy(AvlTree* tree, void (*func)(AvlNode*));
 
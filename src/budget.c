@@ -0,0 +1,79 @@
+#include "./budget.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "./avl.h"
+#include "./registry.h"
+
+static RcdBudget* budgets;
+static pthread_mutex_t budgets_lock = PTHREAD_MUTEX_INITIALIZER;
+
+RcdBudget* rcd_budget_create(const char* name, size_t soft_limit, size_t hard_limit, RcdBudgetFn on_soft_limit, void* ctx) {
+    RcdBudget* budget = (RcdBudget*)calloc(1, sizeof(RcdBudget));
+    if (budget == NULL)
+        return NULL;
+
+    if (name)
+        strncpy(budget->name, name, BUDGET_NAME_SIZE - 1);
+    budget->soft_limit = soft_limit;
+    budget->hard_limit = hard_limit;
+    budget->on_soft_limit = on_soft_limit;
+    budget->ctx = ctx;
+
+    pthread_mutex_lock(&budgets_lock);
+    budget->next = budgets;
+    budgets = budget;
+    pthread_mutex_unlock(&budgets_lock);
+    return budget;
+}
+
+static void budget_disown(AvlNode* node, void* budget) {
+    if (node->owner == budget)
+        node->owner = NULL;
+}
+
+void rcd_budget_destroy(RcdBudget* budget) {
+    if (budget == NULL)
+        return;
+
+    pthread_mutex_lock(&budgets_lock);
+    RcdBudget** link = &budgets;
+    while (*link && *link != budget)
+        link = &(*link)->next;
+    if (*link)
+        *link = budget->next;
+    pthread_mutex_unlock(&budgets_lock);
+
+    // The blocks still charged to it are no longer accounted
+    registry_for_each_node(budget_disown, budget);
+    free(budget);
+}
+
+int budget_charge(RcdBudget* budget, size_t size) {
+    size_t used = __atomic_add_fetch(&budget->used, size, __ATOMIC_RELAXED);
+    if (budget->hard_limit && (used > budget->hard_limit || used < size)) {
+        __atomic_sub_fetch(&budget->used, size, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    // Only the charge that crosses the soft limit calls back
+    if (budget->soft_limit && used >= budget->soft_limit && used - size < budget->soft_limit && budget->on_soft_limit)
+        budget->on_soft_limit(budget, used, budget->ctx);
+    return 0;
+}
+
+size_t rcd_budget_used(const RcdBudget* budget) {
+    return __atomic_load_n(&budget->used, __ATOMIC_RELAXED);
+}
+
+const char* rcd_budget_name(const RcdBudget* budget) {
+    return budget->name;
+}
+
+void budget_reset_all() {
+    pthread_mutex_lock(&budgets_lock);
+    for (RcdBudget* budget = budgets; budget; budget = budget->next)
+        __atomic_store_n(&budget->used, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&budgets_lock);
+}
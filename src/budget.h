@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "./lib.h"
+
+// Longest budget name kept, including the terminator
+#define BUDGET_NAME_SIZE 32
+
+/**
+ * @struct RcdBudget
+ * @brief An accounting group, charged for the blocks allocated under it.
+ *
+ * `used` is only updated with atomics, so that threads sharing a budget
+ * never take a lock. Budgets are kept in a list for quit() to reset them.
+ */
+struct RcdBudget {
+    char name[BUDGET_NAME_SIZE];
+    size_t soft_limit;
+    size_t hard_limit;
+    size_t used;
+    RcdBudgetFn on_soft_limit;
+    void* ctx;
+    struct RcdBudget* next;
+};
+
+/**
+ * @brief Charges `size` bytes to a budget. O(1)
+ *
+ * Calls the soft limit callback when the charge crosses it.
+ *
+ * @param budget The budget.
+ * @param size The number of bytes.
+ * @return 0 on success, -1 if the hard limit would be exceeded.
+ */
+int budget_charge(RcdBudget* budget, size_t size);
+
+/**
+ * @brief Gives `size` bytes back to a budget. O(1)
+ *
+ * @param budget The budget.
+ * @param size The number of bytes.
+ */
+static inline void budget_uncharge(RcdBudget* budget, size_t size) {
+    __atomic_sub_fetch(&budget->used, size, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Resets every budget, once all the blocks are freed by quit().
+ */
+void budget_reset_all();
@@ -0,0 +1,142 @@
+#include "./copy.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Copies up to this size are left to the compiler's inline memcpy
+#define COPY_SMALL_MAX 256
+
+// Used when the last level cache size cannot be queried
+#define COPY_STREAM_DEFAULT_THRESHOLD (4ul << 20)
+
+typedef void (*CopyKernel)(void* restrict, const void* restrict, size_t);
+
+/**
+ * @struct CopyKernels
+ * @brief The copy kernels selected for the running CPU.
+ *
+ * `vector` copies through the cache, `stream` writes with non-temporal
+ * stores so that large copies don't evict the working set.
+ */
+typedef struct {
+    CopyKernel vector;
+    CopyKernel stream;
+    size_t stream_threshold;
+} CopyKernels;
+
+static CopyKernels copy_kernels;
+// Selected once, by the first copy large enough to need a kernel
+static pthread_once_t copy_kernels_once = PTHREAD_ONCE_INIT;
+
+static void copy_kernel_libc(void* restrict dst, const void* restrict src, size_t size) {
+    memcpy(dst, src, size);
+}
+
+#if defined(__x86_64__)
+
+/*
+ * Every kernel copies unaligned heads and tails with memcpy and runs its main
+ * loop four vectors at a time, with stores aligned to the vector width.
+ */
+#define COPY_KERNEL_LOOP(VEC, WIDTH, LOAD, STORE)                              \
+    uint8_t* d = (uint8_t*)dst;                                                \
+    const uint8_t* s = (const uint8_t*)src;                                    \
+    size_t head = (WIDTH - ((uintptr_t)d & (WIDTH - 1))) & (WIDTH - 1);        \
+    memcpy(d, s, head);                                                        \
+    d += head; s += head; size -= head;                                        \
+    for (; size >= 4 * WIDTH; d += 4 * WIDTH, s += 4 * WIDTH, size -= 4 * WIDTH) { \
+        VEC a = LOAD((const VEC*)(s + 0 * WIDTH));                             \
+        VEC b = LOAD((const VEC*)(s + 1 * WIDTH));                             \
+        VEC c = LOAD((const VEC*)(s + 2 * WIDTH));                             \
+        VEC e = LOAD((const VEC*)(s + 3 * WIDTH));                             \
+        STORE((VEC*)(d + 0 * WIDTH), a);                                       \
+        STORE((VEC*)(d + 1 * WIDTH), b);                                       \
+        STORE((VEC*)(d + 2 * WIDTH), c);                                       \
+        STORE((VEC*)(d + 3 * WIDTH), e);                                       \
+    }                                                                          \
+    memcpy(d, s, size);
+
+__attribute__((target("avx2")))
+static void copy_kernel_avx2(void* restrict dst, const void* restrict src, size_t size) {
+    COPY_KERNEL_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_store_si256)
+}
+
+__attribute__((target("avx2")))
+static void copy_kernel_avx2_stream(void* restrict dst, const void* restrict src, size_t size) {
+    COPY_KERNEL_LOOP(__m256i, 32, _mm256_loadu_si256, _mm256_stream_si256)
+    _mm_sfence();
+}
+
+__attribute__((target("avx512f")))
+static void copy_kernel_avx512(void* restrict dst, const void* restrict src, size_t size) {
+    COPY_KERNEL_LOOP(__m512i, 64, _mm512_loadu_si512, _mm512_store_si512)
+}
+
+__attribute__((target("avx512f")))
+static void copy_kernel_avx512_stream(void* restrict dst, const void* restrict src, size_t size) {
+    COPY_KERNEL_LOOP(__m512i, 64, _mm512_loadu_si512, _mm512_stream_si512)
+    _mm_sfence();
+}
+
+// SSE2 is part of x86-64, so streaming stores are always available
+static void copy_kernel_sse2_stream(void* restrict dst, const void* restrict src, size_t size) {
+    COPY_KERNEL_LOOP(__m128i, 16, _mm_loadu_si128, _mm_stream_si128)
+    _mm_sfence();
+}
+
+#undef COPY_KERNEL_LOOP
+
+#endif
+
+/**
+ * @brief Selects the copy kernels for the running CPU with CPUID.
+ *
+ * The streaming threshold is half of the last level cache: above it, a copy
+ * would evict more than it could ever reuse.
+ */
+static void copy_kernels_select() {
+    copy_kernels.vector = copy_kernel_libc;
+    copy_kernels.stream = copy_kernel_libc;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        copy_kernels.vector = copy_kernel_avx512;
+        copy_kernels.stream = copy_kernel_avx512_stream;
+    }
+    else if (__builtin_cpu_supports("avx2")) {
+        copy_kernels.vector = copy_kernel_avx2;
+        copy_kernels.stream = copy_kernel_avx2_stream;
+    }
+    else {
+        copy_kernels.stream = copy_kernel_sse2_stream;
+    }
+#endif
+
+    long cache = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    copy_kernels.stream_threshold = cache > 0 ?
+        (size_t)cache / 2 : COPY_STREAM_DEFAULT_THRESHOLD;
+}
+
+void copy_bytes(void* restrict dst, const void* restrict src, size_t size) {
+    if (size <= COPY_SMALL_MAX) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    pthread_once(&copy_kernels_once, copy_kernels_select);
+
+    if (size >= copy_kernels.stream_threshold)
+        copy_kernels.stream(dst, src, size);
+    else
+        copy_kernels.vector(dst, src, size);
+}
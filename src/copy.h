@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Copies `size` bytes, picking the kernel by size.
+ *
+ * Small copies go to memcpy, larger ones to the vector kernel selected for the
+ * running CPU, and copies larger than half of the last level cache to its
+ * non-temporal streaming kernel.
+ *
+ * @param dst The destination, which must not overlap the source.
+ * @param src The source.
+ * @param size The number of bytes to copy.
+ */
+void copy_bytes(void* restrict dst, const void* restrict src, size_t size);
@@ -0,0 +1,101 @@
+#include "./cow.h"
+
+#include <linux/memfd.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "./copy.h"
+#include "./pagemap.h"
+#include "./ptrmap.h"
+
+// From the address of each block to its CowFile
+static PtrMap cow_blocks;
+
+static size_t cow_page() {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+void* cow_alloc(size_t size) {
+    size_t page = cow_page();
+    size_t length = (size + page - 1) & ~(page - 1);
+
+    int fd = (int)syscall(SYS_memfd_create, "rcd", MFD_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    CowFile* file = (CowFile*)malloc(sizeof(CowFile));
+    void* ptr = file && ftruncate(fd, (off_t)length) == 0 ?
+        mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (ptr == MAP_FAILED) {
+        free(file);
+        close(fd);
+        return NULL;
+    }
+
+    file->fd = fd;
+    file->refs = 1;
+    file->length = length;
+    file->shared = 1;
+
+    if (cow_blocks.keys == NULL)
+        ptrmap_init(&cow_blocks, 16);
+    ptrmap_put(&cow_blocks, (uint64_t)(uintptr_t)ptr, (uint64_t)(uintptr_t)file);
+    return ptr;
+}
+
+typedef struct {
+    char* dst;
+    const char* src;
+} CowDirty;
+
+static void cow_copy_run(size_t offset, size_t length, void* ctx) {
+    CowDirty* dirty = (CowDirty*)ctx;
+    copy_bytes(dirty->dst + offset, dirty->src + offset, length);
+}
+
+void* cow_copy(void* ptr, size_t size) {
+    uint64_t value;
+    if (cow_blocks.keys == NULL || !ptrmap_get(&cow_blocks, (uint64_t)(uintptr_t)ptr, &value))
+        return NULL;
+
+    CowFile* file = (CowFile*)(uintptr_t)value;
+    size_t page = cow_page();
+    if (((size + page - 1) & ~(page - 1)) != file->length)
+        return NULL;
+
+    // Remapped in place, the content is the one the writes left in the file
+    if (file->shared) {
+        if (mmap(ptr, file->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file->fd, 0) == MAP_FAILED)
+            return NULL;
+        file->shared = 0;
+    }
+
+    void* new_ptr = mmap(NULL, file->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file->fd, 0);
+    if (new_ptr == MAP_FAILED)
+        return NULL;
+    // The pages the source wrote since the file was frozen are its own
+    CowDirty dirty = { (char*)new_ptr, (const char*)ptr };
+    if (pagemap_dirty_runs(ptr, file->length, cow_copy_run, &dirty) != 0) {
+        munmap(new_ptr, file->length);
+        return NULL;
+    }
+
+    file->refs++;
+    ptrmap_put(&cow_blocks, (uint64_t)(uintptr_t)new_ptr, value);
+    return new_ptr;
+}
+
+void cow_release(void* ptr) {
+    uint64_t value;
+    if (!ptrmap_take(&cow_blocks, (uint64_t)(uintptr_t)ptr, &value))
+        return;
+
+    CowFile* file = (CowFile*)(uintptr_t)value;
+    munmap(ptr, file->length);
+    if (--file->refs == 0) {
+        close(file->fd);
+        free(file);
+    }
+}
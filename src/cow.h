@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct CowFile
+ * @brief The memfd behind a block and its copy-on-write copies.
+ *
+ * The first block maps the file shared, so that its writes land in the file.
+ * Its first copy freezes the file: from then on every block maps it private
+ * and keeps the pages it writes to itself.
+ * Size: 24 bytes
+ */
+typedef struct {
+    int fd;
+    uint32_t refs;
+    size_t length;
+    int shared;
+} CowFile;
+
+/**
+ * @brief Allocates a block backed by its own memfd.
+ *
+ * @param size The size of the block.
+ * @return The block, or NULL on failure.
+ */
+void* cow_alloc(size_t size);
+
+/**
+ * @brief Maps a copy of a memfd backed block. O(pages)
+ *
+ * The copy shares the pages of the file, only the pages the source wrote
+ * since the file was frozen are copied, found through /proc/self/pagemap.
+ *
+ * @param ptr The block to copy.
+ * @param size The size of the copy, which must span as many pages.
+ * @return The copy, or NULL if it can't be mapped, then the block must be
+ * copied as any other.
+ */
+void* cow_copy(void* ptr, size_t size);
+
+/**
+ * @brief Unmaps a memfd backed block, once it is no longer tracked.
+ *
+ * The memfd is closed with its last block.
+ *
+ * @param ptr The block.
+ */
+void cow_release(void* ptr);
@@ -0,0 +1,164 @@
+#include "./guard.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "./banners.h"
+
+/*
+ * The pool is laid out as [guard][data][guard][data]...[guard], every page
+ * but the live data ones being PROT_NONE. An overflow runs into the next
+ * guard page and a use after free into a protected data page, both fault
+ * right at the faulty access.
+ */
+static char* guard_base;
+static size_t guard_page;
+static GuardSlot* guard_slots;
+static size_t guard_slot_count;
+
+// Free slots, oldest first
+static uint32_t* guard_queue;
+static size_t guard_head;
+static size_t guard_free;
+static pthread_mutex_t guard_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static char* guard_data_page(size_t slot) {
+    return guard_base + (2 * slot + 1) * guard_page;
+}
+
+int guard_init(size_t slots) {
+    int result = 0;
+
+    pthread_mutex_lock(&guard_lock);
+    if (guard_base == NULL) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        void* base = mmap(NULL, (2 * slots + 1) * page, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        GuardSlot* slot_array = (GuardSlot*)calloc(slots, sizeof(GuardSlot));
+        uint32_t* queue = (uint32_t*)malloc(slots * sizeof(uint32_t));
+
+        if (base == MAP_FAILED || slot_array == NULL || queue == NULL) {
+            if (base != MAP_FAILED)
+                munmap(base, (2 * slots + 1) * page);
+            free(slot_array);
+            free(queue);
+            result = -1;
+        }
+        else {
+            for (size_t i = 0; i < slots; i++)
+                queue[i] = (uint32_t)i;
+
+            guard_page = page;
+            guard_slots = slot_array;
+            guard_slot_count = slots;
+            guard_queue = queue;
+            guard_head = 0;
+            guard_free = slots;
+            __atomic_store_n(&guard_base, (char*)base, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&guard_lock);
+
+    return result;
+}
+
+void* guard_alloc(size_t size, void* site) {
+    if (__atomic_load_n(&guard_base, __ATOMIC_ACQUIRE) == NULL || size > guard_page)
+        return NULL;
+
+    // Flush against the guard page, within the alignment malloc() would give
+    size_t align = size < 16 ?
+        sizeof(void*) : 16;
+    size_t used = (size + align - 1) & ~(align - 1);
+    if (used == 0)
+        used = align;
+    if (used > guard_page)
+        return NULL;
+
+    pthread_mutex_lock(&guard_lock);
+    if (guard_free == 0) {
+        pthread_mutex_unlock(&guard_lock);
+        return NULL;
+    }
+    uint32_t index = guard_queue[guard_head];
+    guard_head = (guard_head + 1) % guard_slot_count;
+    guard_free--;
+
+    char* page = guard_data_page(index);
+    if (mprotect(page, guard_page, PROT_READ | PROT_WRITE) != 0) {
+        guard_queue[(guard_head + guard_free) % guard_slot_count] = index;
+        guard_free++;
+        pthread_mutex_unlock(&guard_lock);
+        return NULL;
+    }
+
+    GuardSlot* slot = &guard_slots[index];
+    slot->ptr = page + guard_page - used;
+    slot->size = size;
+    slot->site = site;
+    slot->tid = (uint32_t)syscall(SYS_gettid);
+    slot->state = GUARD_LIVE;
+    pthread_mutex_unlock(&guard_lock);
+
+    return slot->ptr;
+}
+
+void guard_release(void* ptr) {
+    size_t index = (size_t)((char*)ptr - guard_base) / guard_page / 2;
+    char* page = guard_data_page(index);
+
+    pthread_mutex_lock(&guard_lock);
+    // The content is discarded, the protection stays
+    madvise(page, guard_page, MADV_DONTNEED);
+    mprotect(page, guard_page, PROT_NONE);
+    guard_slots[index].state = GUARD_FREED;
+    guard_queue[(guard_head + guard_free) % guard_slot_count] = (uint32_t)index;
+    guard_free++;
+    pthread_mutex_unlock(&guard_lock);
+}
+
+static void guard_describe(const char* kind, char* addr, const GuardSlot* slot) {
+    long offset = (long)(addr - slot->ptr);
+    printf(
+        "\n" ERROR_BANNER "\x1b[31m%s \x1b[30mat %p, %ld bytes %s the block of %zu bytes at %p\n"
+        "allocated by thread %u from %p.\x1b[0m\n",
+        kind, (void*)addr,
+        offset < 0 ? -offset : offset - (long)slot->size,
+        offset < 0 ? "before" : "after",
+        slot->size, (void*)slot->ptr, slot->tid, slot->site);
+}
+
+int guard_report(void* addr) {
+    char* base = __atomic_load_n(&guard_base, __ATOMIC_ACQUIRE);
+    char* fault = (char*)addr;
+    if (base == NULL || fault < base || fault >= base + (2 * guard_slot_count + 1) * guard_page)
+        return 0;
+
+    size_t page = (size_t)(fault - base) / guard_page;
+    if (page % 2) {
+        const GuardSlot* slot = &guard_slots[page / 2];
+        if (slot->state == GUARD_FREED) {
+            printf(
+                "\n" ERROR_BANNER "\x1b[31mUse after free \x1b[30mat %p, %ld bytes into the freed block\n"
+                "of %zu bytes at %p allocated by thread %u from %p.\x1b[0m\n",
+                addr, (long)(fault - slot->ptr), slot->size, (void*)slot->ptr, slot->tid, slot->site);
+        }
+        else {
+            printf("\n" ERROR_BANNER "\x1b[31mWild access \x1b[30mat %p, to an unused sampled page.\x1b[0m\n", addr);
+        }
+        return 1;
+    }
+
+    // A guard page: blocks end against the next one
+    if (page > 0 && guard_slots[page / 2 - 1].state != GUARD_FREE)
+        guard_describe("Heap buffer overflow", fault, &guard_slots[page / 2 - 1]);
+    else if (page / 2 < guard_slot_count && guard_slots[page / 2].state != GUARD_FREE)
+        guard_describe("Heap buffer underflow", fault, &guard_slots[page / 2]);
+    else
+        printf("\n" ERROR_BANNER "\x1b[31mWild access \x1b[30mat %p, to a guard page.\x1b[0m\n", addr);
+    return 1;
+}
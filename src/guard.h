@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pages for sampled blocks when RcdConfig.guard_slots is 0
+#define GUARD_DEFAULT_SLOTS 64
+
+/**
+ * @enum GuardState
+ * @brief What the data page of a slot holds.
+ */
+typedef enum {
+    GUARD_FREE,   // Never used, protected
+    GUARD_LIVE,   // A sampled block
+    GUARD_FREED,  // A dropped block, protected until the slot is reused
+} GuardState;
+
+/**
+ * @struct GuardSlot
+ * @brief A data page of the guarded pool, and who allocated its block.
+ * Size: 32 bytes
+ */
+typedef struct {
+    char* ptr;
+    size_t size;
+    void* site;
+    uint32_t tid;
+    uint32_t state;
+} GuardSlot;
+
+/**
+ * @brief Maps the guarded pool, where guard and data pages alternate.
+ *
+ * Does nothing if the pool is already mapped.
+ *
+ * @param slots The number of data pages.
+ * @return 0 on success, -1 on failure.
+ */
+int guard_init(size_t slots);
+
+/**
+ * @brief Places a block at the end of a data page, against the next guard page.
+ *
+ * Slots are reused in the order they were freed, so that a dropped block
+ * stays protected as long as possible. Thread-safe.
+ *
+ * @param size The size of the block.
+ * @param site The address the block is allocated from.
+ * @return The block, or NULL if it doesn't fit a page or no slot is free.
+ */
+void* guard_alloc(size_t size, void* site);
+
+/**
+ * @brief Protects the page of a sampled block, once it is no longer tracked.
+ *
+ * @param ptr The block.
+ */
+void guard_release(void* ptr);
+
+/**
+ * @brief Reports a fault on the guarded pool.
+ *
+ * @param addr The faulting address.
+ * @return 1 if the address belongs to the pool, 0 otherwise.
+ */
+int guard_report(void* addr);
@@ -0,0 +1,182 @@
+#include "./handle.h"
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "./registry.h"
+
+static HandleTable* handles;
+// The generation of new slots, past every one a released table gave out
+static uint32_t handle_epoch = 1;
+
+// Creates the table on first use, it is tracked as a single block
+static HandleTable* handle_table() {
+    if (__builtin_expect(handles != NULL, 1))
+        return handles;
+
+    HandleTable* table = (HandleTable*)calloc(1, sizeof(HandleTable));
+    if (table == NULL)
+        return NULL;
+
+    void* arena = mmap(NULL, HANDLE_ARENA_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED) {
+        free(table);
+        return NULL;
+    }
+
+    table->arena = (char*)arena;
+    table->top = table->arena;
+    table->touched = table->arena;
+    table->free_slot = HANDLE_NONE;
+
+    AvlNode* node = registry_insert(table, sizeof(HandleTable));
+    if (node == NULL) {
+        munmap(arena, HANDLE_ARENA_SIZE);
+        free(table);
+        return NULL;
+    }
+    node->kind = REGISTRY_HANDLES;
+    handles = table;
+    return table;
+}
+
+void handle_release(HandleTable* table) {
+    if (table == handles)
+        handles = NULL;
+
+    // The handles of this table must not match the slots of the next one
+    for (uint32_t i = 0; i < table->slot_count; i++) {
+        if (table->slots[i].generation >= handle_epoch)
+            handle_epoch = table->slots[i].generation + 1;
+    }
+    if (handle_epoch == 0)
+        handle_epoch = 1;
+
+    munmap(table->arena, HANDLE_ARENA_SIZE);
+    free(table->slots);
+    free(table);
+}
+
+static uint32_t slot_acquire(HandleTable* table) {
+    uint32_t index = table->free_slot;
+    if (index != HANDLE_NONE) {
+        table->free_slot = table->slots[index].next_free;
+        return index;
+    }
+
+    if (table->slot_count == table->slot_capacity) {
+        uint32_t capacity = table->slot_capacity ?
+            table->slot_capacity * 2 : HANDLE_MIN_SLOTS;
+        if (capacity < table->slot_capacity)
+            return HANDLE_NONE;
+
+        HandleSlot* slots = (HandleSlot*)realloc(table->slots, capacity * sizeof(HandleSlot));
+        if (slots == NULL)
+            return HANDLE_NONE;
+
+        table->slots = slots;
+        table->slot_capacity = capacity;
+    }
+
+    index = table->slot_count++;
+    table->slots[index].generation = handle_epoch;
+    return index;
+}
+
+RcdHandle rcd_handle_alloc(size_t size) {
+    HandleTable* table = handle_table();
+    if (table == NULL || size > HANDLE_ARENA_SIZE)
+        return RCD_HANDLE_NULL;
+
+    // Blocks stay 16 bytes aligned, like malloc() ones
+    size_t span = sizeof(HandleBlock) + ((size + 15) & ~(size_t)15);
+    if (span > (size_t)(table->arena + HANDLE_ARENA_SIZE - table->top))
+        return RCD_HANDLE_NULL;
+
+    uint32_t index = slot_acquire(table);
+    if (index == HANDLE_NONE)
+        return RCD_HANDLE_NULL;
+
+    HandleBlock* block = (HandleBlock*)table->top;
+    block->size = span;
+    block->slot = index;
+    table->top += span;
+    if (table->top > table->touched)
+        table->touched = table->top;
+
+    HandleSlot* slot = &table->slots[index];
+    slot->ptr = block + 1;
+    return ((RcdHandle)slot->generation << 32) | index;
+}
+
+void* rcd_handle_get(RcdHandle handle) {
+    HandleTable* table = handles;
+    uint32_t index = (uint32_t)handle;
+    if (table == NULL || index >= table->slot_count || table->slots[index].generation != (uint32_t)(handle >> 32))
+        return NULL;
+
+    return table->slots[index].ptr;
+}
+
+void rcd_handle_drop(RcdHandle handle) {
+    void* ptr = rcd_handle_get(handle);
+    if (ptr == NULL)
+        return;
+
+    HandleTable* table = handles;
+    HandleBlock* block = (HandleBlock*)ptr - 1;
+    block->slot = HANDLE_NONE;
+
+    // The last block is popped right away, the others wait for rcd_compact()
+    if ((char*)block + block->size == table->top)
+        table->top = (char*)block;
+    else
+        table->dead += block->size;
+
+    uint32_t index = (uint32_t)handle;
+    HandleSlot* slot = &table->slots[index];
+    slot->ptr = NULL;
+    if (++slot->generation == 0)
+        slot->generation = 1;
+    slot->next_free = table->free_slot;
+    table->free_slot = index;
+}
+
+size_t rcd_compact() {
+    HandleTable* table = handles;
+    if (table == NULL)
+        return 0;
+
+    // Live blocks slide down over the dead ones, keeping their order
+    if (table->dead) {
+        char* dst = table->arena;
+        char* src = table->arena;
+        while (src < table->top) {
+            HandleBlock* block = (HandleBlock*)src;
+            size_t span = block->size;
+            if (block->slot != HANDLE_NONE) {
+                if (dst != src) {
+                    memmove(dst, src, span);
+                    table->slots[((HandleBlock*)dst)->slot].ptr = (HandleBlock*)dst + 1;
+                }
+                dst += span;
+            }
+            src += span;
+        }
+        table->top = dst;
+        table->dead = 0;
+    }
+
+    // The pages past the last block go back to the OS
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)table->top + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t)table->touched + page - 1) & ~(page - 1);
+    table->touched = table->top;
+    if (end <= start)
+        return 0;
+
+    madvise((void*)start, end - start, MADV_DONTNEED);
+    return end - start;
+}
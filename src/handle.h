@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "./lib.h"
+
+// Address space reserved for the arena, its pages are only backed once touched
+#define HANDLE_ARENA_SIZE (1ul << 36)
+#define HANDLE_MIN_SLOTS 64
+
+// Marks the end of the slot freelist, and the blocks dropped since the last compaction
+#define HANDLE_NONE UINT32_MAX
+
+/**
+ * @struct HandleSlot
+ * @brief Where the block of a handle currently is.
+ *
+ * The generation is bumped on every drop, so that the handles given out
+ * before no longer match it. New slots start past the generations of the
+ * tables released by quit(), so that their handles don't match either.
+ * Size: 16 bytes
+ */
+typedef struct {
+    void* ptr;
+    uint32_t generation;
+    uint32_t next_free;
+} HandleSlot;
+
+/**
+ * @struct HandleBlock
+ * @brief The header of a block in the arena, followed by its data.
+ *
+ * `size` spans the header and the padded data, so that the arena can be
+ * walked from block to block.
+ * Size: 16 bytes
+ */
+typedef struct {
+    size_t size;
+    uint32_t slot;
+    uint32_t padding;
+} HandleBlock;
+
+/**
+ * @struct HandleTable
+ * @brief The slots of the handles and the arena holding their blocks.
+ *
+ * Blocks are bump allocated from `top`. `touched` is the highest address used
+ * since the last compaction, up to which the pages may be backed.
+ */
+typedef struct {
+    char* arena;
+    char* top;
+    char* touched;
+    size_t dead;
+    HandleSlot* slots;
+    uint32_t slot_count;
+    uint32_t slot_capacity;
+    uint32_t free_slot;
+} HandleTable;
+
+/**
+ * @brief Unmaps the arena and frees the table, once it is no longer tracked.
+ *
+ * @param table The table to release.
+ */
+void handle_release(HandleTable* table);
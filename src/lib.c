@@ -0,0 +1,543 @@
+#include "./lib.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "./avl.h"
+#include "./budget.h"
+#include "./copy.h"
+#include "./cow.h"
+#include "./guard.h"
+#include "./handle.h"
+#include "./pool.h"
+#include "./record.h"
+#include "./registry.h"
+#include "./signals.h"
+#include "./sizeclass.h"
+#include "./trace.h"
+
+// Nodes preallocated by the registry unless configured otherwise
+#define RCD_DEFAULT_REGISTRY_CAPACITY 1024
+
+static AvlTree* gc;
+static RcdConfig rcd_config;
+
+// Reaches zero on the next alloc() of the thread that takes the slow path
+__thread size_t rcd_alloc_countdown;
+static __thread size_t sample_countdown;
+static __thread uint64_t sample_seed;
+
+// Charged for the blocks the thread allocates, if any
+static __thread RcdBudget* budget_current __attribute__((tls_model("initial-exec")));
+
+// Set once the registry exists, read without the lock by the fast paths
+static int rcd_ready;
+static pthread_mutex_t rcd_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Reads a positive integer from the environment, keeps `value` otherwise
+static void env_size(const char* name, size_t* value) {
+    const char* text = getenv(name);
+    if (text == NULL)
+        return;
+
+    char* end;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (*text && *end == '\0' && parsed > 0)
+        *value = (size_t)parsed;
+    else
+        fprintf(stderr, WARN_BANNER "Ignoring invalid %s=%s\n", name, text);
+}
+
+RcdConfig rcd_config_from_env() {
+    RcdConfig config = {
+        .registry_capacity = RCD_DEFAULT_REGISTRY_CAPACITY,
+        .signals = RCD_SIGNALS_ALL,
+        .teardown = RCD_TEARDOWN_FREE,
+        .trace_path = getenv("RCD_TRACE"),
+        .trace_size = TRACE_DEFAULT_SIZE,
+        .record_path = getenv("RCD_RECORD"),
+        .sample_rate = 0,
+        .guard_slots = GUARD_DEFAULT_SLOTS,
+        .cow_threshold = 0,
+    };
+
+    env_size("RCD_REGISTRY_CAPACITY", &config.registry_capacity);
+    env_size("RCD_TRACE_SIZE", &config.trace_size);
+    env_size("RCD_SAMPLE_RATE", &config.sample_rate);
+    env_size("RCD_GUARD_SLOTS", &config.guard_slots);
+    env_size("RCD_COW_THRESHOLD", &config.cow_threshold);
+
+    const char* signals = getenv("RCD_SIGNALS");
+    if (signals) {
+        int mask = signals_parse(signals);
+        if (mask >= 0)
+            config.signals = mask;
+        else
+            fprintf(stderr, WARN_BANNER "Ignoring invalid RCD_SIGNALS=%s\n", signals);
+    }
+
+    const char* teardown = getenv("RCD_TEARDOWN");
+    if (teardown) {
+        if (strcmp(teardown, "free") == 0)
+            config.teardown = RCD_TEARDOWN_FREE;
+        else if (strcmp(teardown, "leak") == 0)
+            config.teardown = RCD_TEARDOWN_LEAK;
+        else
+            fprintf(stderr, WARN_BANNER "Ignoring invalid RCD_TEARDOWN=%s\n", teardown);
+    }
+
+    return config;
+}
+
+int rcd_init(const RcdConfig* config) {
+    int done;
+
+    pthread_mutex_lock(&rcd_init_lock);
+    done = __atomic_load_n(&rcd_ready, __ATOMIC_ACQUIRE);
+    if (!done) {
+        rcd_config = config ?
+            *config : rcd_config_from_env();
+        signals_install(rcd_config.signals);
+        gc = avl_new(rcd_config.registry_capacity);
+        if (rcd_config.trace_path) {
+            size_t size = rcd_config.trace_size ?
+                rcd_config.trace_size : TRACE_DEFAULT_SIZE;
+            if (trace_start(rcd_config.trace_path, size) != 0)
+                fprintf(stderr, WARN_BANNER "Cannot trace to %s\n", rcd_config.trace_path);
+        }
+        if (rcd_config.record_path && record_start(rcd_config.record_path) != 0)
+            fprintf(stderr, WARN_BANNER "Cannot record to %s\n", rcd_config.record_path);
+        // Every operation must then be seen, the size classes step aside
+        __atomic_store_n(&rcd_class_bypass, trace_enabled || record_enabled, __ATOMIC_RELAXED);
+        if (rcd_config.sample_rate) {
+            size_t slots = rcd_config.guard_slots ?
+                rcd_config.guard_slots : GUARD_DEFAULT_SLOTS;
+            if (guard_init(slots) != 0) {
+                fprintf(stderr, WARN_BANNER "Cannot map %zu guarded pages, sampling is off\n", slots);
+                rcd_config.sample_rate = 0;
+            }
+        }
+        __atomic_store_n(&rcd_ready, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&rcd_init_lock);
+
+    return done ?
+        -1 : 0;
+}
+
+void registry_release(void* ptr, int kind) {
+    switch (kind) {
+        case REGISTRY_POOL:
+            pool_release((RcdPool*)ptr);
+            break;
+        case REGISTRY_HANDLES:
+            handle_release((HandleTable*)ptr);
+            break;
+        case REGISTRY_GUARDED:
+            guard_release(ptr);
+            break;
+        case REGISTRY_COW:
+            cow_release(ptr);
+            break;
+        default:
+            free(ptr);
+    }
+}
+
+static void registry_release_node(AvlNode* node) {
+    registry_release(node->key, node->kind);
+}
+
+void quit() {
+    pthread_mutex_lock(&rcd_init_lock);
+    if (__atomic_load_n(&rcd_ready, __ATOMIC_ACQUIRE)) {
+        avl_iter_destroy(gc, registry_release_node);
+        gc = NULL;
+        __atomic_store_n(&rcd_ready, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&rcd_init_lock);
+    sizeclass_reset();
+    __atomic_store_n(&rcd_class_bypass, 0, __ATOMIC_RELAXED);
+    rcd_alloc_countdown = 0;
+    budget_reset_all();
+
+    // The addresses in a new session are unrelated to the ones of this one
+    trace_stop(1);
+    record_stop();
+}
+
+// Run at exit() or main return
+static void __attribute__((destructor)) teardown() {
+    if (rcd_config.teardown == RCD_TEARDOWN_FREE)
+        quit();
+    // With RCD_TEARDOWN_LEAK, threads may still trace until exit: the ring stays
+    trace_stop(0);
+    record_stop();
+}
+
+AvlNode* registry_insert(void* ptr, size_t size) {
+    if (__builtin_expect(!__atomic_load_n(&rcd_ready, __ATOMIC_ACQUIRE), 0))
+        rcd_init(NULL);
+
+    return avl_insert(gc, ptr, size);
+}
+
+int registry_remove(void* ptr) {
+    return gc ?
+        avl_remove(gc, ptr, NULL) : -1;
+}
+
+AvlNode* registry_find(void* ptr) {
+    return gc ?
+        avl_find(gc, ptr) : NULL;
+}
+
+void registry_for_each_node(void (*fn)(AvlNode*, void*), void* ctx) {
+    if (gc)
+        avl_iter_nodes(gc, fn, ctx);
+}
+
+// The recorded size of a block, or the size of its class, 0 if untracked
+static size_t registry_size(void* ptr) {
+    size_t class_size = sizeclass_size(ptr);
+    if (class_size)
+        return class_size;
+
+    AvlNode* node = registry_find(ptr);
+    return node ?
+        node->size : 0;
+}
+
+// Uniform in [1, 2 * rate), so that periodic allocation patterns can't dodge sampling
+static size_t sample_interval(size_t rate) {
+    if (sample_seed == 0)
+        sample_seed = (uint64_t)(uintptr_t)&sample_seed | 1;
+    sample_seed ^= sample_seed << 13;
+    sample_seed ^= sample_seed >> 7;
+    sample_seed ^= sample_seed << 17;
+    return rate > 1 ?
+        1 + sample_seed % (2 * rate - 1) : 1;
+}
+
+/*
+ * Taken by the sampled alloc() calls, by the first one of each thread to arm
+ * its countdown, by every alloc() of a thread with a budget, and by the
+ * large ones.
+ */
+void* rcd_alloc_slow(size_t size) {
+    if (__builtin_expect(!__atomic_load_n(&rcd_ready, __ATOMIC_ACQUIRE), 0))
+        rcd_init(NULL);
+
+    size_t rate = rcd_config.sample_rate;
+    RcdBudget* budget = budget_current;
+    int sampled = 0;
+    // Large blocks get here without counting down
+    if (size < RCD_LARGE_SIZE) {
+        if (rate && (budget == NULL || sample_countdown-- == 0)) {
+            sampled = 1;
+            sample_countdown = sample_interval(rate) - 1;
+        }
+        rcd_alloc_countdown = budget ?
+            0 : rate ? sample_countdown : SIZE_MAX;
+    }
+
+    if (budget && budget_charge(budget, size) != 0)
+        return NULL;
+
+    void* ptr = NULL;
+    int kind = REGISTRY_HEAP;
+    if (sampled) {
+        ptr = guard_alloc(size, __builtin_return_address(0));
+        kind = REGISTRY_GUARDED;
+    }
+    else if (rcd_config.cow_threshold && size >= rcd_config.cow_threshold && size >= RCD_LARGE_SIZE) {
+        ptr = cow_alloc(size);
+        kind = REGISTRY_COW;
+    }
+    if (ptr == NULL) {
+        ptr = malloc(size);
+        kind = REGISTRY_HEAP;
+    }
+    if (ptr == NULL) {
+        if (budget)
+            budget_uncharge(budget, size);
+        return NULL;
+    }
+
+    AvlNode* node = registry_insert(ptr, size);
+    if (node == NULL) {
+        registry_release(ptr, kind);
+        if (budget)
+            budget_uncharge(budget, size);
+        return NULL;
+    }
+    node->kind = kind;
+    node->owner = budget;
+    TRACE(TRACE_ALLOC, ptr, NULL, size);
+    RECORD(RECORD_ALLOC, ptr, NULL, size);
+    return ptr;
+}
+
+RcdBudget* rcd_budget_set(RcdBudget* budget) {
+    RcdBudget* previous = budget_current;
+    if (budget == previous)
+        return previous;
+
+    // A thread with a budget takes the slow path on every alloc()
+    if (budget && previous == NULL) {
+        sample_countdown = rcd_alloc_countdown;
+        rcd_alloc_countdown = 0;
+    }
+    else if (budget == NULL) {
+        rcd_alloc_countdown = sample_countdown;
+    }
+    budget_current = budget;
+    return previous;
+}
+
+RcdBudget* rcd_budget_get() {
+    return budget_current;
+}
+
+void rcd_track(void* ptr, size_t size) {
+    registry_insert(ptr, size);
+    TRACE(TRACE_ALLOC, ptr, NULL, size);
+    RECORD(RECORD_ALLOC, ptr, NULL, size);
+}
+
+int rcd_untrack(void* ptr) {
+    TRACE(TRACE_DROP, ptr, NULL, registry_size(ptr));
+    RECORD(RECORD_DROP, ptr, NULL, 0);
+
+    if (sizeclass_size(ptr)) {
+        sizeclass_put(ptr);
+        return 0;
+    }
+
+    // Untracked pointers are freed as before
+    AvlNode removed;
+    int kind = gc ?
+        avl_remove(gc, ptr, &removed) : -1;
+    if (kind >= 0 && removed.owner)
+        budget_uncharge((RcdBudget*)removed.owner, removed.size);
+    if (__builtin_expect(kind <= REGISTRY_HEAP, 1))
+        return 1;
+
+    registry_release(ptr, kind);
+    return 0;
+}
+
+// Copies into a new block without tracing nor charging, shared by copy() and resize()
+static void* duplicate(void* ptr, size_t size, RcdBudget* owner) {
+    size_t recorded = registry_size(ptr);
+    size_t used = recorded && recorded < size ?
+        recorded : size;
+
+    void* new_ptr = malloc(size);
+    if (new_ptr == NULL)
+        return NULL;
+
+    AvlNode* node = registry_insert(new_ptr, size);
+    if (node == NULL) {
+        free(new_ptr);
+        return NULL;
+    }
+
+    copy_bytes(new_ptr, ptr, used);
+    node->owner = owner;
+    return new_ptr;
+}
+
+// Memfd backed blocks are copied by mapping their pages again when possible
+static void* duplicate_cow(void* ptr, size_t size, RcdBudget* owner) {
+    AvlNode* node = registry_find(ptr);
+    void* new_ptr = node && node->kind == REGISTRY_COW ?
+        cow_copy(ptr, size) : NULL;
+    if (new_ptr == NULL)
+        return duplicate(ptr, size, owner);
+
+    AvlNode* inserted = registry_insert(new_ptr, size);
+    if (inserted == NULL) {
+        cow_release(new_ptr);
+        return NULL;
+    }
+    inserted->kind = REGISTRY_COW;
+    inserted->owner = owner;
+    return new_ptr;
+}
+
+void* copy(void* ptr, size_t size) {
+    if (ptr == NULL)
+        return alloc(size);
+
+    // The copy belongs to the thread making it, like a new block
+    RcdBudget* budget = budget_current;
+    if (budget && budget_charge(budget, size) != 0)
+        return NULL;
+
+    void* new_ptr = size >= RCD_LARGE_SIZE ?
+        duplicate_cow(ptr, size, budget) : duplicate(ptr, size, budget);
+    if (new_ptr == NULL && budget)
+        budget_uncharge(budget, size);
+    TRACE(TRACE_COPY, new_ptr, ptr, size);
+    RECORD(RECORD_COPY, new_ptr, ptr, size);
+    return new_ptr;
+}
+
+int rcd_owner(const void* addr, void** base, size_t* size) {
+    if (sizeclass_size(addr))
+        return sizeclass_owner(addr, base, size);
+
+    AvlNode* node = gc ?
+        avl_floor(gc, (void*)addr) : NULL;
+    if (node == NULL || (uintptr_t)addr - (uintptr_t)node->key >= node->size)
+        return 0;
+
+    if (base)
+        *base = node->key;
+    if (size)
+        *size = node->size;
+    return 1;
+}
+
+void rcd_for_each_in_range(const void* lo, const void* hi, RcdBlockFn fn, void* ctx) {
+    if (gc == NULL || lo >= hi)
+        return;
+
+    // The block starting before `lo` may still reach into the range
+    AvlNode* first = avl_floor(gc, (void*)lo);
+    if (first && first->key < lo && (uintptr_t)lo - (uintptr_t)first->key < first->size)
+        fn(first->key, first->size, ctx);
+
+    avl_iter_range(gc, (void*)lo, (void*)hi, fn, ctx);
+}
+
+void copy_many(void** new_ptrs, void* const* ptrs, size_t count) {
+    void** keys = (void**)malloc(count * sizeof(void*));
+    size_t* sizes = (size_t*)malloc(count * sizeof(size_t));
+    size_t tracked = 0;
+    RcdBudget* budget = budget_current;
+
+    // Without memory for the batch, the blocks are copied one by one
+    if (keys == NULL || sizes == NULL) {
+        free(sizes);
+        free(keys);
+        for (size_t i = 0; i < count; i++) {
+            size_t size = registry_size(ptrs[i]);
+            new_ptrs[i] = size ?
+                copy(ptrs[i], size) : NULL;
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        // Objects of the size classes are copied whole
+        size_t size = sizeclass_size(ptrs[i]);
+        AvlNode* node = size == 0 && gc && ptrs[i] ?
+            avl_find(gc, ptrs[i]) : NULL;
+        if (node)
+            size = node->size;
+        new_ptrs[i] = NULL;
+        if ((node == NULL && size == 0) || (budget && budget_charge(budget, size) != 0))
+            continue;
+
+        new_ptrs[i] = malloc(size);
+        if (new_ptrs[i] == NULL) {
+            if (budget)
+                budget_uncharge(budget, size);
+            continue;
+        }
+
+        copy_bytes(new_ptrs[i], ptrs[i], size);
+        TRACE(TRACE_COPY, new_ptrs[i], ptrs[i], size);
+        RECORD(RECORD_COPY, new_ptrs[i], ptrs[i], size);
+        keys[tracked] = new_ptrs[i];
+        sizes[tracked++] = size;
+    }
+
+    // The copies left out of the registry, the last ones, are refunded and freed
+    size_t inserted = tracked ?
+        avl_insert_many(gc, keys, sizes, tracked, budget) : 0;
+    for (size_t i = count; inserted < tracked && i-- > 0;) {
+        if (new_ptrs[i] != keys[tracked - 1])
+            continue;
+
+        tracked--;
+        if (budget)
+            budget_uncharge(budget, sizes[tracked]);
+        TRACE(TRACE_DROP, new_ptrs[i], NULL, sizes[tracked]);
+        RECORD(RECORD_DROP, new_ptrs[i], NULL, 0);
+        free(new_ptrs[i]);
+        new_ptrs[i] = NULL;
+    }
+    free(sizes);
+    free(keys);
+}
+
+void* resize(void* ptr, size_t new_size) {
+    if (ptr == NULL)
+        return alloc(new_size);
+
+    // Like realloc(), a zero size frees the block
+    if (new_size == 0) {
+        drop(ptr);
+        return NULL;
+    }
+
+    // The block stays charged to its owner, for the difference only
+    AvlNode* node = registry_find(ptr);
+    RcdBudget* owner = node ?
+        (RcdBudget*)node->owner : NULL;
+    size_t old_size = node ?
+        node->size : 0;
+    if (owner && new_size > old_size && budget_charge(owner, new_size - old_size) != 0)
+        return NULL;
+
+    // realloc() grows in place when it can, then only the size changes
+    void* old = ptr;
+    void* new_ptr;
+
+    if (node && node->kind == REGISTRY_HEAP) {
+        new_ptr = realloc(ptr, new_size);
+        if (new_ptr) {
+            // Read back from the node, `ptr` is dead past realloc()
+            old = node->key;
+            if (new_ptr == old) {
+                node->size = new_size;
+            }
+            else {
+                registry_remove(node->key);
+                AvlNode* moved = registry_insert(new_ptr, new_size);
+                if (moved) {
+                    moved->owner = owner;
+                }
+                else if (owner) {
+                    // Left untracked, drop() still frees it but no longer refunds it
+                    budget_uncharge(owner, new_size > old_size ?
+                        new_size : old_size);
+                    owner = NULL;
+                }
+            }
+        }
+    }
+    else {
+        new_ptr = duplicate(ptr, new_size, owner);
+        if (new_ptr && sizeclass_size(ptr))
+            sizeclass_put(ptr);
+        else if (new_ptr)
+            registry_release(ptr, registry_remove(ptr));
+    }
+
+    if (owner && new_ptr == NULL && new_size > old_size)
+        budget_uncharge(owner, new_size - old_size);
+    if (owner && new_ptr && new_size < old_size)
+        budget_uncharge(owner, old_size - new_size);
+    if (new_ptr == NULL)
+        return NULL;
+
+    TRACE(TRACE_RESIZE, new_ptr, old, new_size);
+    RECORD(RECORD_RESIZE, new_ptr, old, new_size);
+    return new_ptr;
+}
@@ -1,61 +1,484 @@
 #pragma once
 
-#include <string.h>
-
-#include "./avl.h"
-#include "./signals.h"
-
-static AvlTree* gc;
-
-// Run at the start of the program
-void __attribute__((constructor)) startup() {
-    signal(SIGHUP, sighup_handler);
-    signal(SIGINT, sigint_handler);
-    signal(SIGQUIT, sigquit_handler);
-    signal(SIGILL, sigill_handler);
-    signal(SIGTRAP, sigtrap_handler);
-    signal(SIGABRT, sigabrt_handler);
-    signal(SIGFPE, sigfpe_handler);
-    signal(SIGSEGV, sigsegv_handler);
-    signal(SIGPIPE, sigpipe_handler);
-    signal(SIGALRM, sigalrm_handler);
-    signal(SIGTERM, sigterm_handler);
-
-    gc = avl_new();
-}
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 
-// Run at exit() or main return
-void __attribute__((destructor)) quit() {
-    avl_iter_destroy(gc, free);
-}
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The library is built with hidden visibility, only the API is exported
+#define RCD_API __attribute__((visibility("default")))
+
+// Signals rcd can install a handler for, see RcdConfig
+#define RCD_SIGNAL_HUP (1 << 0)
+#define RCD_SIGNAL_INT (1 << 1)
+#define RCD_SIGNAL_QUIT (1 << 2)
+#define RCD_SIGNAL_ILL (1 << 3)
+#define RCD_SIGNAL_TRAP (1 << 4)
+#define RCD_SIGNAL_ABRT (1 << 5)
+#define RCD_SIGNAL_FPE (1 << 6)
+#define RCD_SIGNAL_SEGV (1 << 7)
+#define RCD_SIGNAL_PIPE (1 << 8)
+#define RCD_SIGNAL_ALRM (1 << 9)
+#define RCD_SIGNAL_TERM (1 << 10)
+
+#define RCD_SIGNALS_ALL ((1 << 11) - 1)
+#define RCD_SIGNALS_FAULTS \
+    (RCD_SIGNAL_ILL | RCD_SIGNAL_TRAP | RCD_SIGNAL_ABRT | RCD_SIGNAL_FPE | RCD_SIGNAL_SEGV)
+
+/**
+ * @enum RcdTeardown
+ * @brief What happens to the tracked blocks when the program exits.
+ */
+typedef enum {
+    RCD_TEARDOWN_FREE,  // Every tracked block is freed
+    RCD_TEARDOWN_LEAK,  // The blocks are left to the OS, exit is instant
+} RcdTeardown;
+
+/**
+ * @struct RcdConfig
+ * @brief Settings applied when rcd is initialized.
+ *
+ * `signals` is a mask of RCD_SIGNAL_* handlers to install. A signal that the
+ * program already handles or ignores is never taken over.
+ *
+ * When `trace_path` is set, alloc(), drop(), copy() and resize() are traced
+ * to that file, a ring of `trace_size` bytes (64 MiB if 0). Convert it with
+ * `trace2json` to load it in chrome://tracing or Perfetto.
+ *
+ * When `record_path` is set, the same operations are recorded there in a
+ * compact form that `replay` runs against rcd and malloc.
+ *
+ * When `sample_rate` is not 0, about one alloc() in `sample_rate` of up to a
+ * page is placed against a guard page, in a pool of `guard_slots` pages. An
+ * overflow or a use after free on such a block faults at once, and the
+ * SIGSEGV handler reports it. Each thread picks up the rate on its first
+ * alloc().
+ *
+ * When `cow_threshold` is not 0, blocks of at least that many bytes (never
+ * less than RCD_LARGE_SIZE) are mapped from a memfd, and copy() maps their
+ * copies copy-on-write: only the pages written afterwards are duplicated.
+ * Until its first copy, such a block is mapped shared, and a child process
+ * created by fork() meanwhile shares its pages with the parent.
+ */
+typedef struct {
+    size_t registry_capacity;
+    int signals;
+    RcdTeardown teardown;
+    const char* trace_path;
+    size_t trace_size;
+    const char* record_path;
+    size_t sample_rate;
+    size_t guard_slots;
+    size_t cow_threshold;
+} RcdConfig;
+
+/**
+ * @brief Gets the default configuration, overridden by the environment.
+ *
+ * RCD_REGISTRY_CAPACITY: the number of registry nodes to preallocate.
+ * RCD_SIGNALS: "all", "none", or signal names, e.g. "segv,abrt,fpe".
+ * RCD_TEARDOWN: "free" or "leak".
+ * RCD_TRACE: the trace file, tracing is off if unset.
+ * RCD_TRACE_SIZE: the size of the trace file in bytes.
+ * RCD_RECORD: the recording file, recording is off if unset.
+ * RCD_SAMPLE_RATE: guard one alloc() in that many, sampling is off if unset.
+ * RCD_GUARD_SLOTS: the number of pages for the sampled blocks.
+ * RCD_COW_THRESHOLD: the size from which blocks are copied on write, off if unset.
+ */
+RCD_API RcdConfig rcd_config_from_env();
+
+/**
+ * @brief Initializes rcd. Thread-safe.
+ *
+ * This is otherwise done by the first alloc(), with rcd_config_from_env().
+ *
+ * @param config The configuration, or NULL for rcd_config_from_env().
+ * @return 0 on success, -1 if rcd was already initialized.
+ */
+RCD_API int rcd_init(const RcdConfig* config);
+
+// Registry updates behind the inlined fast paths
+RCD_API void rcd_track(void* ptr, size_t size);
+// Returns 1 if the caller must free() the block, other kinds are released
+RCD_API int rcd_untrack(void* ptr);
+// Counts down to the next alloc() taking the slow path: sampled, or charged to a budget
+RCD_API extern __thread size_t rcd_alloc_countdown;
+// Allocations from this size always take the slow path
+#define RCD_LARGE_SIZE (1ul << 20)
+RCD_API void* rcd_alloc_slow(size_t size);
+
+// Frees every tracked block and ends tracing and recording, also run at exit()
+// with RCD_TEARDOWN_FREE. The next alloc() initializes rcd again.
+RCD_API void quit();
+
+// Copies at most the recorded size of the block, the rest is uninitialized
+RCD_API void* copy(void* ptr, size_t size);
+
+// Duplicates `count` blocks with their recorded sizes in one registry update
+RCD_API void copy_many(void** new_ptrs, void* const* ptrs, size_t count);
+
+RCD_API void* resize(void* ptr, size_t new_size);
+
+/**
+ * @brief Finds the tracked block containing an address. O(log2(n))
+ *
+ * Live objects of the size classes have the size of their class.
+ *
+ * @param addr Any address, possibly inside a block.
+ * @param base Receives the start of the block, may be NULL.
+ * @param size Receives the size of the block, may be NULL.
+ * @return 1 if a block contains `addr`, 0 otherwise.
+ */
+RCD_API int rcd_owner(const void* addr, void** base, size_t* size);
+
+typedef void (*RcdBlockFn)(void* base, size_t size, void* ctx);
+
+/**
+ * @brief Calls `fn` for every tracked block overlapping [lo, hi), in address order. O(log2(n) + k)
+ *
+ * `fn` must not allocate or drop tracked blocks. Objects of the size classes
+ * are not tracked one by one and so not listed.
+ *
+ * @param lo The start of the range.
+ * @param hi The end of the range, excluded.
+ * @param fn The function to call for each block.
+ * @param ctx Passed to `fn`.
+ */
+RCD_API void rcd_for_each_in_range(const void* lo, const void* hi, RcdBlockFn fn, void* ctx);
+
+/*
+ * With rcd_alloc_auto(), constant sizes of up to RCD_CLASS_MAX bytes are
+ * rounded up to a multiple of RCD_CLASS_GRANULE, each such size class having
+ * its own arena in a region reserved once. Threads carve their objects from
+ * the arenas and recycle them through per-thread freelists, the class of an
+ * object following from its address. Objects of the size classes are not
+ * tracked one by one: a byte per granule, past the arenas, tells the live
+ * ones, and quit() reclaims the whole region.
+ */
+#define RCD_CLASS_GRANULE 16
+#define RCD_CLASS_MAX 256
+#define RCD_CLASSES (RCD_CLASS_MAX / RCD_CLASS_GRANULE)
+#define RCD_CLASS_OF(size) (((size) + RCD_CLASS_GRANULE - 1) / RCD_CLASS_GRANULE - 1)
+#define RCD_CLASS_SIZE(cls) (((size_t)(cls) + 1) * RCD_CLASS_GRANULE)
+// Every class gets an arena of 1 << RCD_CLASS_ARENA_SHIFT bytes
+#define RCD_CLASS_ARENA_SHIFT 30
+#define RCD_CLASS_REGION ((uintptr_t)RCD_CLASSES << RCD_CLASS_ARENA_SHIFT)
+// The liveness byte of the object at `offset` in the region
+#define RCD_CLASS_LIVE(offset) \
+    ((unsigned char*)rcd_class_base + RCD_CLASS_REGION + (offset) / RCD_CLASS_GRANULE)
+// Past that many objects, a thread hands its freelist back to the other ones
+#define RCD_CLASS_CACHE_MAX 256
+
+/**
+ * @struct RcdClassCache
+ * @brief The objects of a size class at hand for a thread.
+ * Size: 32 bytes
+ */
+typedef struct {
+    void* free;
+    char* next;
+    char* end;
+    size_t count;
+} RcdClassCache;
+
+RCD_API extern __thread RcdClassCache rcd_class_caches[RCD_CLASSES];
+// The start of the region, out of reach of any pointer until it is reserved
+RCD_API extern uintptr_t rcd_class_base;
+// Set while tracing or recording, the size classes then go through alloc() and drop()
+RCD_API extern int rcd_class_bypass;
+// Hands out a batch of objects, behind rcd_class_alloc()
+RCD_API void* rcd_class_refill(unsigned cls, size_t size);
+// Hands a full freelist back, behind drop()
+RCD_API void rcd_class_flush(RcdClassCache* cache);
 
 // Memory management with Reference Counting Destructor
-void* alloc(size_t size) {
+static inline void* alloc(size_t size) {
+    if (__builtin_expect(size >= RCD_LARGE_SIZE || rcd_alloc_countdown-- == 0, 0))
+        return rcd_alloc_slow(size);
+
     void* ptr = malloc(size);
-    avl_insert(gc, ptr);
+    if (ptr)
+        rcd_track(ptr, size);
     return ptr;
 }
 
-void drop(void* ptr) {
-    avl_remove(gc, ptr);
-    free(ptr);
+// alloc() for a size of class `cls`, known at compile time
+static inline void* rcd_class_alloc(unsigned cls, size_t size) {
+    if (__builtin_expect(rcd_class_bypass, 0))
+        return alloc(size);
+    if (__builtin_expect(rcd_alloc_countdown-- == 0, 0))
+        return rcd_alloc_slow(size);
+
+    RcdClassCache* cache = &rcd_class_caches[cls];
+    void* obj = cache->free;
+    if (__builtin_expect(obj != NULL, 1)) {
+        cache->free = *(void**)obj;
+        cache->count--;
+    }
+    else if (__builtin_expect(cache->next < cache->end, 1)) {
+        obj = cache->next;
+        cache->next += RCD_CLASS_SIZE(cls);
+    }
+    else {
+        return rcd_class_refill(cls, size);
+    }
+
+    *RCD_CLASS_LIVE((uintptr_t)obj - rcd_class_base) = 1;
+    return obj;
+}
+
+/*
+ * alloc() for sizes that are often compile-time constants, e.g. sizeof(T):
+ * those of up to RCD_CLASS_MAX bytes resolve their class at compile time,
+ * leaving a freelist pop, the others call alloc(). alloc() itself stays a
+ * function, so allocation sites opt in to the size classes through this
+ * macro. From C++, see also rcd::alloc<Size>() and rcd::alloc<T>() in rcd.hpp.
+ */
+#define rcd_alloc_auto(size)                                                 \
+    (__builtin_constant_p(size) && (size_t)(size) - 1 < RCD_CLASS_MAX ?     \
+        rcd_class_alloc(RCD_CLASS_OF((size_t)(size)), (size)) : alloc(size))
+
+static inline void drop(void* ptr) {
+    uintptr_t offset = (uintptr_t)ptr - rcd_class_base;
+    if (__builtin_expect(offset < RCD_CLASS_REGION && !rcd_class_bypass, 1)) {
+        RcdClassCache* cache = &rcd_class_caches[offset >> RCD_CLASS_ARENA_SHIFT];
+        *RCD_CLASS_LIVE(offset) = 0;
+        *(void**)ptr = cache->free;
+        cache->free = ptr;
+        if (__builtin_expect(++cache->count > RCD_CLASS_CACHE_MAX, 0))
+            rcd_class_flush(cache);
+        return;
+    }
+
+    if (rcd_untrack(ptr))
+        free(ptr);
 }
 
-// [!] Produce invalid reads
-void* copy(void* ptr, size_t size) {
-    if (ptr == NULL)
-        alloc(size);
+/**
+ * @struct RcdPool
+ * @brief A pool of objects of the same size.
+ *
+ * Objects are carved from contiguous chunks and recycled through an intrusive
+ * freelist, the last released object being the first one reused. The pool is
+ * tracked as a single block: quit() or drop() frees it along with its chunks.
+ * A pool is not thread-safe.
+ */
+typedef struct {
+    void* free;
+    char* next;
+    char* end;
+    size_t obj_size;
+    size_t chunk_size;
+    void* chunks;
+} RcdPool;
 
-    void* new_ptr = alloc(size);
-    memcpy(new_ptr, ptr, size);
+/**
+ * @brief Creates a pool of objects of `obj_size` bytes.
+ *
+ * Objects are aligned to 16 bytes, or to 8 bytes if smaller than 16.
+ *
+ * @param obj_size The size of the objects.
+ * @return The pool, or NULL on failure.
+ */
+RCD_API RcdPool* rcd_pool_create(size_t obj_size);
 
-    return new_ptr;
+/**
+ * @brief Frees a pool and all of its objects.
+ *
+ * @param pool The pool to destroy.
+ */
+RCD_API void rcd_pool_destroy(RcdPool* pool);
+
+// Carves a new chunk, behind rcd_pool_get()
+RCD_API void* rcd_pool_refill(RcdPool* pool);
+
+static inline void* rcd_pool_get(RcdPool* pool) {
+    void* obj = pool->free;
+    if (__builtin_expect(obj != NULL, 1)) {
+        pool->free = *(void**)obj;
+        return obj;
+    }
+
+    if (__builtin_expect(pool->next < pool->end, 1)) {
+        obj = pool->next;
+        pool->next += pool->obj_size;
+        return obj;
+    }
+
+    return rcd_pool_refill(pool);
 }
 
-// [!] Produce invalid reads
-void* resize(void* ptr, size_t new_size) {
-    void* new_ptr = copy(ptr, new_size);
-    drop(ptr);
+static inline void rcd_pool_put(RcdPool* pool, void* obj) {
+    *(void**)obj = pool->free;
+    pool->free = obj;
+}
+
+/**
+ * @brief A reference to a block that rcd_compact() may move.
+ *
+ * A handle packs the index of its slot with the generation of the slot when
+ * it was given out, a dropped handle is detected instead of reaching a reused
+ * block. Handles are not thread-safe and must not be used past quit().
+ */
+typedef uint64_t RcdHandle;
+
+#define RCD_HANDLE_NULL ((RcdHandle)0)
+
+/**
+ * @brief Allocates a block owned by a handle. O(1)
+ *
+ * @param size The size of the block.
+ * @return The handle, or RCD_HANDLE_NULL on failure.
+ */
+RCD_API RcdHandle rcd_handle_alloc(size_t size);
+
+/**
+ * @brief Resolves a handle to its block. O(1)
+ *
+ * The address stays valid until the next rcd_compact().
+ *
+ * @param handle The handle.
+ * @return The block, or NULL if the handle was dropped.
+ */
+RCD_API void* rcd_handle_get(RcdHandle handle);
+
+/**
+ * @brief Frees the block of a handle, stale handles are ignored. O(1)
+ *
+ * @param handle The handle to drop.
+ */
+RCD_API void rcd_handle_drop(RcdHandle handle);
+
+/**
+ * @brief Slides the blocks owned by handles together. O(n)
+ *
+ * The space left by dropped blocks is reclaimed and the pages past the last
+ * block are given back to the OS.
+ *
+ * @return The number of bytes given back.
+ */
+RCD_API size_t rcd_compact();
+
+/**
+ * @struct RcdBudget
+ * @brief A named accounting group for the blocks allocated under it.
+ */
+typedef struct RcdBudget RcdBudget;
+
+// Called by the thread whose allocation crosses the soft limit, with the usage
+typedef void (*RcdBudgetFn)(RcdBudget* budget, size_t used, void* ctx);
+
+/**
+ * @brief Creates a budget.
+ *
+ * The blocks allocated by alloc(), copy() and copy_many() on a thread are
+ * charged to the budget current on that thread, and resize() moves the
+ * charge of a block along with it. Past the soft limit `on_soft_limit` is
+ * called, an allocation that would exceed the hard limit fails with NULL.
+ *
+ * @param name The name of the budget, at most 31 characters are kept.
+ * @param soft_limit The soft limit in bytes, or 0 for none.
+ * @param hard_limit The hard limit in bytes, or 0 for none.
+ * @param on_soft_limit The soft limit callback, may be NULL.
+ * @param ctx Passed to `on_soft_limit`.
+ * @return The budget, or NULL on failure.
+ */
+RCD_API RcdBudget* rcd_budget_create(const char* name, size_t soft_limit, size_t hard_limit, RcdBudgetFn on_soft_limit, void* ctx);
+
+/**
+ * @brief Destroys a budget, its blocks are no longer accounted. O(n)
+ *
+ * The budget must not be current on any thread.
+ *
+ * @param budget The budget to destroy.
+ */
+RCD_API void rcd_budget_destroy(RcdBudget* budget);
+
+/**
+ * @brief Sets the budget of the calling thread.
+ *
+ * Threads without a budget keep the inlined alloc() fast path.
+ *
+ * @param budget The budget, or NULL for none.
+ * @return The previous budget of the thread.
+ */
+RCD_API RcdBudget* rcd_budget_set(RcdBudget* budget);
+
+// The budget of the calling thread, or NULL
+RCD_API RcdBudget* rcd_budget_get();
+
+// The number of bytes charged to a budget
+RCD_API size_t rcd_budget_used(const RcdBudget* budget);
+
+RCD_API const char* rcd_budget_name(const RcdBudget* budget);
+
+/**
+ * @struct RcdPersist
+ * @brief A heap kept in a file, which a restarted program maps back as is.
+ *
+ * The heap is always mapped at the same address, so that the pointers stored
+ * in it stay valid without any deserialization. Its blocks are not tracked:
+ * quit() leaves them alone. A persistent heap is not thread-safe.
+ */
+typedef struct RcdPersist RcdPersist;
+
+/**
+ * @brief Opens a persistent heap, creating its file if needed.
+ *
+ * An existing heap keeps its size and base, and a checkpoint interrupted by
+ * a crash is completed first.
+ *
+ * @param path The heap file, next to which `<path>.journal` is kept.
+ * @param size The size of a new heap.
+ * @param base Where a new heap is mapped, page aligned, or NULL for the default.
+ * @return The heap, or NULL if the file is not a heap or its base is taken.
+ */
+RCD_API RcdPersist* rcd_persist_open(const char* path, size_t size, void* base);
+
+/**
+ * @brief Allocates a block in a persistent heap. O(1)
+ *
+ * @param heap The heap.
+ * @param size The size of the block.
+ * @return The block, 16 bytes aligned, or NULL if the heap is full.
+ */
+RCD_API void* rcd_persist_alloc(RcdPersist* heap, size_t size);
+
+// Frees a block of a persistent heap, and the root naming it if any. O(1)
+RCD_API void rcd_persist_free(RcdPersist* heap, void* ptr);
+
+/**
+ * @brief Finds a root object by name, or creates it zeroed.
+ *
+ * @param heap The heap.
+ * @param name The name of the root, up to 55 characters.
+ * @param size The size of a new root, or 0 to only look it up.
+ * @return The root, or NULL if it can't be found or created.
+ */
+RCD_API void* rcd_persist_root(RcdPersist* heap, const char* name, size_t size);
+
+// Calls `fn` for every block of a persistent heap, in address order. O(n)
+RCD_API void rcd_persist_for_each(RcdPersist* heap, RcdBlockFn fn, void* ctx);
+
+/**
+ * @brief Saves the heap to its file, atomically. O(pages)
+ *
+ * The pages written since the last checkpoint are first written to the
+ * journal, which is committed, then to the heap file. After a crash the
+ * file holds either this checkpoint or the previous one. No other thread
+ * may write to the heap meanwhile.
+ *
+ * @param heap The heap.
+ * @return 0 on success, -1 on failure.
+ */
+RCD_API int rcd_persist_checkpoint(RcdPersist* heap);
+
+// Checkpoints and unmaps a persistent heap, returns the checkpoint result
+RCD_API int rcd_persist_close(RcdPersist* heap);
 
-    return new_ptr;
+#ifdef __cplusplus
 }
+#endif
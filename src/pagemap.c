@@ -0,0 +1,60 @@
+#include "./pagemap.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Pagemap entry bits, see Documentation/admin-guide/mm/pagemap.rst
+#define PAGEMAP_PRESENT (1ull << 63)
+#define PAGEMAP_SWAPPED (1ull << 62)
+#define PAGEMAP_FILE (1ull << 61)
+
+// Pagemap entries read at once
+#define PAGEMAP_BATCH 512
+
+// /proc/self is resolved on open, a forked child must open its own
+static int pagemap_fd = -1;
+static pid_t pagemap_pid;
+
+int pagemap_dirty_runs(const void* base, size_t length, void (*fn)(size_t offset, size_t length, void* ctx), void* ctx) {
+    pid_t pid = getpid();
+    if (pagemap_fd >= 0 && pagemap_pid != pid) {
+        close(pagemap_fd);
+        pagemap_fd = -1;
+    }
+    if (pagemap_fd < 0) {
+        pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+        pagemap_pid = pid;
+    }
+    if (pagemap_fd < 0)
+        return -1;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages = length / page;
+    uint64_t entries[PAGEMAP_BATCH];
+    size_t run = 0;
+
+    for (size_t first = 0; first < pages; first += PAGEMAP_BATCH) {
+        size_t count = pages - first < PAGEMAP_BATCH ?
+            pages - first : PAGEMAP_BATCH;
+        off_t offset = (off_t)(((uintptr_t)base / page + first) * sizeof(uint64_t));
+        if (pread(pagemap_fd, entries, count * sizeof(uint64_t), offset) != (ssize_t)(count * sizeof(uint64_t)))
+            return -1;
+
+        // Consecutive written pages are reported at once
+        for (size_t i = 0; i < count; i++) {
+            uint64_t entry = entries[i];
+            if ((entry & PAGEMAP_SWAPPED) || ((entry & PAGEMAP_PRESENT) && !(entry & PAGEMAP_FILE))) {
+                run++;
+                continue;
+            }
+            if (run) {
+                fn((first + i - run) * page, run * page, ctx);
+                run = 0;
+            }
+        }
+    }
+    if (run)
+        fn(length - run * page, run * page, ctx);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Calls `fn` for each run of written pages of a private file mapping. O(pages)
+ *
+ * A written page of a private file mapping is an anonymous page, present or
+ * swapped out, found through /proc/self/pagemap. Any other page still reads
+ * from the file.
+ *
+ * @param base The start of the mapping, page aligned.
+ * @param length The length of the mapping, in whole pages.
+ * @param fn Called with the offset and length of each run of written pages.
+ * @param ctx Passed to `fn`.
+ * @return 0 on success, -1 if the pagemap can't be read.
+ */
+int pagemap_dirty_runs(const void* base, size_t length, void (*fn)(size_t offset, size_t length, void* ctx), void* ctx);
@@ -0,0 +1,350 @@
+#include "./persist.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "./pagemap.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+// FNV-1a, to tell a complete journal from a torn one
+#define PERSIST_HASH_OFFSET 0xcbf29ce484222325ull
+#define PERSIST_HASH_PRIME 0x100000001b3ull
+
+// Bytes of journal read at once when replaying it
+#define PERSIST_BUFFER (64 << 10)
+
+static uint64_t persist_hash(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ bytes[i]) * PERSIST_HASH_PRIME;
+    return hash;
+}
+
+static int persist_write(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return -1;
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+static int persist_read_at(int fd, void* data, size_t size, off_t offset) {
+    return pread(fd, data, size, offset) == (ssize_t)size ?
+        0 : -1;
+}
+
+static int persist_write_at(int fd, const void* data, size_t size, off_t offset) {
+    return pwrite(fd, data, size, offset) == (ssize_t)size ?
+        0 : -1;
+}
+
+// Walks the runs of a journal through `buffer`, see persist_journal_walk()
+static int persist_journal_runs(int journal, int fd, uint64_t count, uint64_t* hash, char* buffer) {
+    off_t position = sizeof(PersistJournal);
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t run[2];
+        if (persist_read_at(journal, run, sizeof(run), position) != 0)
+            return -1;
+        *hash = persist_hash(*hash, run, sizeof(run));
+        position += sizeof(run);
+
+        for (uint64_t done = 0; done < run[1];) {
+            size_t size = run[1] - done < PERSIST_BUFFER ?
+                (size_t)(run[1] - done) : PERSIST_BUFFER;
+            if (persist_read_at(journal, buffer, size, position) != 0)
+                return -1;
+            *hash = persist_hash(*hash, buffer, size);
+            if (fd >= 0 && persist_write_at(fd, buffer, size, (off_t)(run[0] + done)) != 0)
+                return -1;
+            position += size;
+            done += size;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Walks the runs of a journal, hashing them, and writes them to the heap file
+ * unless `fd` is -1. Each walk has its own buffer, so that heaps can be
+ * opened from several threads at once.
+ */
+static int persist_journal_walk(int journal, int fd, uint64_t count, uint64_t* hash) {
+    char* buffer = (char*)malloc(PERSIST_BUFFER);
+    if (buffer == NULL)
+        return -1;
+
+    int result = persist_journal_runs(journal, fd, count, hash, buffer);
+    free(buffer);
+    return result;
+}
+
+/*
+ * A journal with a valid header was committed: it is written to the heap file
+ * again, in case a crash interrupted it. Any other journal was never
+ * committed and the heap file is untouched, so it is discarded.
+ */
+static int persist_replay(RcdPersist* heap) {
+    int journal = open(heap->journal_path, O_RDWR | O_CLOEXEC);
+    if (journal < 0)
+        return errno == ENOENT ?
+            0 : -1;
+
+    PersistJournal header;
+    uint64_t hash = PERSIST_HASH_OFFSET;
+    int result = 0;
+    if (persist_read_at(journal, &header, sizeof(header), 0) == 0 &&
+        memcmp(header.magic, PERSIST_JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+        persist_journal_walk(journal, -1, header.count, &hash) == 0 &&
+        hash == header.checksum) {
+        hash = PERSIST_HASH_OFFSET;
+        if (persist_journal_walk(journal, heap->fd, header.count, &hash) != 0 || fdatasync(heap->fd) != 0)
+            result = -1;
+    }
+
+    if (result == 0 && (ftruncate(journal, 0) != 0 || fdatasync(journal) != 0))
+        result = -1;
+    close(journal);
+    return result;
+}
+
+// Creates the heap file, or checks the one already there
+static int persist_load(RcdPersist* heap, size_t size, void* base, PersistHeader* header) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    struct stat file;
+    if (fstat(heap->fd, &file) != 0)
+        return -1;
+
+    if (file.st_size == 0) {
+        size = (size + page - 1) & ~(page - 1);
+        if (size < 2 * page)
+            size = 2 * page;
+        if (base == NULL)
+            base = PERSIST_DEFAULT_BASE;
+        if ((uintptr_t)base % page)
+            return -1;
+
+        memset(header, 0, sizeof(PersistHeader));
+        memcpy(header->magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC));
+        header->version = PERSIST_VERSION;
+        header->page_size = (uint32_t)page;
+        header->base = (uint64_t)(uintptr_t)base;
+        header->size = size;
+        header->top = page;
+        return ftruncate(heap->fd, (off_t)size) == 0 &&
+            persist_write_at(heap->fd, header, sizeof(PersistHeader), 0) == 0 &&
+            fdatasync(heap->fd) == 0 ?
+                0 : -1;
+    }
+
+    return persist_read_at(heap->fd, header, sizeof(PersistHeader), 0) == 0 &&
+        memcmp(header->magic, PERSIST_MAGIC, sizeof(PERSIST_MAGIC)) == 0 &&
+        header->version == PERSIST_VERSION &&
+        header->page_size == page &&
+        (uint64_t)file.st_size >= header->size ?
+            0 : -1;
+}
+
+static void persist_discard(RcdPersist* heap) {
+    if (heap->fd >= 0)
+        close(heap->fd);
+    free(heap->journal_path);
+    free(heap);
+}
+
+RcdPersist* rcd_persist_open(const char* path, size_t size, void* base) {
+    RcdPersist* heap = (RcdPersist*)calloc(1, sizeof(RcdPersist));
+    if (heap == NULL)
+        return NULL;
+
+    heap->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    heap->journal_path = (char*)malloc(strlen(path) + sizeof(".journal"));
+    if (heap->journal_path)
+        sprintf(heap->journal_path, "%s.journal", path);
+
+    PersistHeader header;
+    if (heap->fd < 0 || heap->journal_path == NULL || persist_replay(heap) != 0 ||
+        persist_load(heap, size, base, &header) != 0) {
+        persist_discard(heap);
+        return NULL;
+    }
+
+    // Written pages stay private until a checkpoint puts them in the file
+    void* map = mmap((void*)(uintptr_t)header.base, header.size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_FIXED_NOREPLACE, heap->fd, 0);
+    if (map != (void*)(uintptr_t)header.base) {
+        if (map != MAP_FAILED)
+            munmap(map, header.size);
+        persist_discard(heap);
+        return NULL;
+    }
+
+    heap->header = (PersistHeader*)map;
+    heap->size = header.size;
+    return heap;
+}
+
+static unsigned persist_class(size_t size) {
+    unsigned size_class = PERSIST_MIN_CLASS;
+    while (size_class < PERSIST_CLASSES && (1ul << size_class) - sizeof(PersistBlock) < size)
+        size_class++;
+    return size_class;
+}
+
+void* rcd_persist_alloc(RcdPersist* heap, size_t size) {
+    unsigned size_class = persist_class(size);
+    if (size_class == PERSIST_CLASSES)
+        return NULL;
+
+    PersistHeader* header = heap->header;
+    PersistBlock* block = (PersistBlock*)header->free[size_class];
+    if (block) {
+        header->free[size_class] = *(void**)(block + 1);
+    }
+    else {
+        uint64_t span = 1ul << size_class;
+        if (span > heap->size - header->top)
+            return NULL;
+
+        block = (PersistBlock*)((char*)header + header->top);
+        block->size_class = size_class;
+        header->top += span;
+    }
+
+    block->state = PERSIST_LIVE;
+    block->size = size;
+    return block + 1;
+}
+
+void rcd_persist_free(RcdPersist* heap, void* ptr) {
+    if (ptr == NULL)
+        return;
+
+    PersistBlock* block = (PersistBlock*)ptr - 1;
+    if (block->state != PERSIST_LIVE)
+        return;
+
+    PersistHeader* header = heap->header;
+    for (int i = 0; i < PERSIST_ROOTS; i++) {
+        if (header->roots[i].ptr == ptr)
+            memset(&header->roots[i], 0, sizeof(PersistRoot));
+    }
+
+    block->state = PERSIST_FREE;
+    *(void**)ptr = header->free[block->size_class];
+    header->free[block->size_class] = block;
+}
+
+void* rcd_persist_root(RcdPersist* heap, const char* name, size_t size) {
+    if (strlen(name) >= PERSIST_NAME_SIZE)
+        return NULL;
+
+    PersistHeader* header = heap->header;
+    PersistRoot* empty = NULL;
+    for (int i = 0; i < PERSIST_ROOTS; i++) {
+        PersistRoot* root = &header->roots[i];
+        if (root->ptr && strcmp(root->name, name) == 0)
+            return root->ptr;
+        if (root->ptr == NULL && empty == NULL)
+            empty = root;
+    }
+    if (size == 0 || empty == NULL)
+        return NULL;
+
+    void* ptr = rcd_persist_alloc(heap, size);
+    if (ptr == NULL)
+        return NULL;
+
+    memset(ptr, 0, size);
+    strcpy(empty->name, name);
+    empty->ptr = ptr;
+    return ptr;
+}
+
+void rcd_persist_for_each(RcdPersist* heap, RcdBlockFn fn, void* ctx) {
+    PersistHeader* header = heap->header;
+    char* position = (char*)header + header->page_size;
+    char* top = (char*)header + header->top;
+    while (position < top) {
+        PersistBlock* block = (PersistBlock*)position;
+        if (block->state == PERSIST_LIVE)
+            fn(block + 1, block->size, ctx);
+        position += 1ul << block->size_class;
+    }
+}
+
+typedef struct {
+    int fd;
+    const char* base;
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t hash;
+    int failed;
+} PersistWriter;
+
+static void persist_journal_run(size_t offset, size_t length, void* ctx) {
+    PersistWriter* writer = (PersistWriter*)ctx;
+    uint64_t run[2] = { offset, length };
+    if (writer->failed)
+        return;
+
+    writer->failed = persist_write(writer->fd, run, sizeof(run)) != 0 ||
+        persist_write(writer->fd, writer->base + offset, length) != 0;
+    writer->hash = persist_hash(writer->hash, run, sizeof(run));
+    writer->hash = persist_hash(writer->hash, writer->base + offset, length);
+    writer->count++;
+    writer->bytes += length;
+}
+
+int rcd_persist_checkpoint(RcdPersist* heap) {
+    int journal = open(heap->journal_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (journal < 0)
+        return -1;
+
+    // The header goes last, once the runs are on disk
+    PersistWriter writer = { journal, (const char*)heap->header, 0, 0, PERSIST_HASH_OFFSET, 0 };
+    lseek(journal, sizeof(PersistJournal), SEEK_SET);
+    if (pagemap_dirty_runs(heap->header, heap->size, persist_journal_run, &writer) != 0 && !writer.failed) {
+        // Without the pagemap, everything up to the top is written
+        size_t page = heap->header->page_size;
+        writer.count = writer.bytes = 0;
+        writer.hash = PERSIST_HASH_OFFSET;
+        lseek(journal, sizeof(PersistJournal), SEEK_SET);
+        persist_journal_run(0, (heap->header->top + page - 1) & ~(page - 1), &writer);
+    }
+
+    PersistJournal header = { PERSIST_JOURNAL_MAGIC, writer.count, writer.bytes, writer.hash };
+    int failed = writer.failed || fdatasync(journal) != 0 ||
+        persist_write_at(journal, &header, sizeof(header), 0) != 0 || fdatasync(journal) != 0;
+    close(journal);
+    if (failed || persist_replay(heap) != 0)
+        return -1;
+
+    // Mapped again from the file, so that the next checkpoint only sees newer writes
+    return mmap(heap->header, heap->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, heap->fd, 0) == MAP_FAILED ?
+        -1 : 0;
+}
+
+int rcd_persist_close(RcdPersist* heap) {
+    if (heap == NULL)
+        return 0;
+
+    int result = rcd_persist_checkpoint(heap);
+    munmap(heap->header, heap->size);
+    persist_discard(heap);
+    return result;
+}
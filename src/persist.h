@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "./lib.h"
+
+#define PERSIST_MAGIC "RCDHEAP"
+#define PERSIST_JOURNAL_MAGIC "RCDJRNL"
+#define PERSIST_VERSION 1
+
+// Where new heaps are mapped unless told otherwise
+#define PERSIST_DEFAULT_BASE ((void*)0x3f0000000000ul)
+
+#define PERSIST_ROOTS 32
+#define PERSIST_NAME_SIZE 56
+
+// Blocks span a power of two, 32 bytes at least, header included
+#define PERSIST_MIN_CLASS 5
+#define PERSIST_CLASSES 48
+
+#define PERSIST_LIVE 0x4c495645u
+#define PERSIST_FREE 0x46524545u
+
+/**
+ * @struct PersistRoot
+ * @brief A named object the program finds its data from after a restart.
+ * Size: 64 bytes
+ */
+typedef struct {
+    char name[PERSIST_NAME_SIZE];
+    void* ptr;
+} PersistRoot;
+
+/**
+ * @struct PersistHeader
+ * @brief The first page of a heap file.
+ *
+ * The heap is always mapped at `base`, so that the pointers it holds stay
+ * valid. Blocks are bump allocated from `top`, an offset in the file, and
+ * freed blocks are kept in one list per size class.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t base;
+    uint64_t size;
+    uint64_t top;
+    void* free[PERSIST_CLASSES];
+    PersistRoot roots[PERSIST_ROOTS];
+} PersistHeader;
+
+/**
+ * @struct PersistBlock
+ * @brief The header of a block, followed by its data.
+ *
+ * The blocks follow each other from the second page up to `top`, this is
+ * the on-disk registry of the heap.
+ * Size: 16 bytes
+ */
+typedef struct {
+    uint32_t size_class;
+    uint32_t state;
+    uint64_t size;
+} PersistBlock;
+
+/**
+ * @struct PersistJournal
+ * @brief The header of a checkpoint journal, written last.
+ *
+ * It is followed by `count` runs, each an offset and a length in the heap
+ * file then the bytes to write there. The checksum covers all the runs.
+ * Size: 32 bytes
+ */
+typedef struct {
+    char magic[8];
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t checksum;
+} PersistJournal;
+
+struct RcdPersist {
+    PersistHeader* header;
+    size_t size;
+    int fd;
+    char* journal_path;
+};
@@ -0,0 +1,71 @@
+#include "./pool.h"
+
+#include "./registry.h"
+
+
+RcdPool* rcd_pool_create(size_t obj_size) {
+    RcdPool* pool = (RcdPool*)malloc(sizeof(RcdPool));
+    if (pool == NULL)
+        return NULL;
+
+    // Room for the freelist link, and the alignment malloc() would give
+    size_t align = obj_size < 16 ?
+        sizeof(void*) : 16;
+    if (obj_size < sizeof(void*))
+        obj_size = sizeof(void*);
+    obj_size = (obj_size + align - 1) & ~(align - 1);
+
+    pool->free = NULL;
+    pool->next = NULL;
+    pool->end = NULL;
+    pool->obj_size = obj_size;
+    pool->chunk_size = sizeof(PoolChunk) + POOL_MIN_OBJECTS * obj_size;
+    pool->chunks = NULL;
+
+    AvlNode* node = registry_insert(pool, sizeof(RcdPool));
+    if (node == NULL) {
+        free(pool);
+        return NULL;
+    }
+    node->kind = REGISTRY_POOL;
+    return pool;
+}
+
+void pool_release(RcdPool* pool) {
+    PoolChunk* chunk = (PoolChunk*)pool->chunks;
+    while (chunk) {
+        PoolChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(pool);
+}
+
+void rcd_pool_destroy(RcdPool* pool) {
+    if (pool == NULL)
+        return;
+
+    registry_remove(pool);
+    pool_release(pool);
+}
+
+void* rcd_pool_refill(RcdPool* pool) {
+    PoolChunk* chunk = (PoolChunk*)malloc(pool->chunk_size);
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->next = (PoolChunk*)pool->chunks;
+    chunk->size = pool->chunk_size;
+    pool->chunks = chunk;
+
+    // The first object is returned, the rest of the chunk is carved lazily
+    char* objects = (char*)(chunk + 1);
+    size_t count = (chunk->size - sizeof(PoolChunk)) / pool->obj_size;
+    pool->next = objects + pool->obj_size;
+    pool->end = objects + count * pool->obj_size;
+
+    if (pool->chunk_size * 2 <= POOL_MAX_CHUNK)
+        pool->chunk_size = sizeof(PoolChunk) + (pool->chunk_size - sizeof(PoolChunk)) * 2;
+
+    return objects;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "./lib.h"
+
+// Chunks start with room for POOL_MIN_OBJECTS and double up to POOL_MAX_CHUNK
+#define POOL_MIN_OBJECTS 64
+#define POOL_MAX_CHUNK (1ul << 20)
+
+/**
+ * @struct PoolChunk
+ * @brief The header of a chunk, followed by its objects.
+ * Size: 16 bytes
+ */
+typedef struct PoolChunk {
+    struct PoolChunk* next;
+    size_t size;
+} PoolChunk;
+
+/**
+ * @brief Frees a pool and its chunks, once it is no longer tracked.
+ *
+ * @param pool The pool to release.
+ */
+void pool_release(RcdPool* pool);
@@ -0,0 +1,93 @@
+#include "./ptrmap.h"
+
+#include <stdlib.h>
+
+
+// Blocks are at least 16 bytes apart, the low bits carry no entropy
+static inline size_t ptrmap_home(PtrMap* map, uint64_t key) {
+    return (size_t)((key >> 4) * 0x9e3779b97f4a7c15ull) & (map->capacity - 1);
+}
+
+static size_t ptrmap_slot(PtrMap* map, uint64_t key) {
+    size_t slot = ptrmap_home(map, key);
+    while (map->keys[slot] != 0 && map->keys[slot] != key)
+        slot = (slot + 1) & (map->capacity - 1);
+    return slot;
+}
+
+void ptrmap_init(PtrMap* map, size_t capacity) {
+    map->capacity = 16;
+    while (map->capacity < capacity * 2)
+        map->capacity *= 2;
+    map->count = 0;
+    map->keys = (uint64_t*)calloc(map->capacity, sizeof(uint64_t));
+    map->values = (uint64_t*)malloc(map->capacity * sizeof(uint64_t));
+}
+
+void ptrmap_free(PtrMap* map) {
+    free(map->keys);
+    free(map->values);
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+static void ptrmap_grow(PtrMap* map) {
+    PtrMap old = *map;
+    ptrmap_init(map, old.capacity);
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.keys[i] != 0)
+            ptrmap_put(map, old.keys[i], old.values[i]);
+    }
+    ptrmap_free(&old);
+}
+
+void ptrmap_put(PtrMap* map, uint64_t key, uint64_t value) {
+    if ((map->count + 1) * 2 > map->capacity)
+        ptrmap_grow(map);
+
+    size_t slot = ptrmap_slot(map, key);
+    if (map->keys[slot] == 0)
+        map->count++;
+    map->keys[slot] = key;
+    map->values[slot] = value;
+}
+
+int ptrmap_get(PtrMap* map, uint64_t key, uint64_t* value) {
+    if (map->capacity == 0)
+        return 0;
+
+    size_t slot = ptrmap_slot(map, key);
+    if (map->keys[slot] == 0)
+        return 0;
+
+    *value = map->values[slot];
+    return 1;
+}
+
+int ptrmap_take(PtrMap* map, uint64_t key, uint64_t* value) {
+    if (map->capacity == 0)
+        return 0;
+
+    size_t slot = ptrmap_slot(map, key);
+    if (map->keys[slot] == 0)
+        return 0;
+    if (value)
+        *value = map->values[slot];
+
+    // Shift back the following entries that may have probed past the hole
+    size_t mask = map->capacity - 1;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; map->keys[next] != 0; next = (next + 1) & mask) {
+        size_t home = ptrmap_home(map, map->keys[next]);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            map->keys[hole] = map->keys[next];
+            map->values[hole] = map->values[next];
+            hole = next;
+        }
+    }
+    map->keys[hole] = 0;
+    map->count--;
+    return 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct PtrMap
+ * @brief An open addressing hash map from addresses to integers.
+ *
+ * Linear probing with backward shift deletion, so there are no tombstones.
+ * The map grows when it is half full. Key 0 is reserved for empty slots.
+ * Size: 32 bytes
+ */
+typedef struct {
+    uint64_t* keys;
+    uint64_t* values;
+    size_t capacity;
+    size_t count;
+} PtrMap;
+
+/**
+ * @brief Initializes an empty map.
+ *
+ * @param map The map to initialize.
+ * @param capacity The expected number of keys.
+ */
+void ptrmap_init(PtrMap* map, size_t capacity);
+
+/**
+ * @brief Frees the slots of a map.
+ *
+ * @param map The map to free.
+ */
+void ptrmap_free(PtrMap* map);
+
+/**
+ * @brief Sets the value of a key. O(1)
+ *
+ * @param map The map.
+ * @param key The key, not 0.
+ * @param value The value.
+ */
+void ptrmap_put(PtrMap* map, uint64_t key, uint64_t value);
+
+/**
+ * @brief Gets the value of a key. O(1)
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param value Receives the value if the key is present.
+ * @return 1 if the key is present, 0 otherwise.
+ */
+int ptrmap_get(PtrMap* map, uint64_t key, uint64_t* value);
+
+/**
+ * @brief Removes a key. O(1)
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param value Receives the value if the key was present, may be NULL.
+ * @return 1 if the key was present, 0 otherwise.
+ */
+int ptrmap_take(PtrMap* map, uint64_t key, uint64_t* value);
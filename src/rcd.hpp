@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "./lib.h"
+#include "./vec.h"
+
+namespace rcd {
+
+namespace detail {
+
+// Sizes past the size classes, and 0, go through alloc()
+template <std::size_t Size, bool Classed = (Size > 0 && Size <= RCD_CLASS_MAX)>
+struct sized {
+    static void* alloc() { return ::alloc(Size); }
+};
+
+template <std::size_t Size>
+struct sized<Size, true> {
+    static constexpr unsigned cls = RCD_CLASS_OF(Size);
+    static void* alloc() { return rcd_class_alloc(cls, Size); }
+};
+
+}
+
+/**
+ * @brief alloc() of a size known at compile time, see rcd_alloc_auto().
+ *
+ * Sizes of up to RCD_CLASS_MAX bytes inline to the freelist of their size
+ * class, the others call alloc(). Objects are released with drop().
+ */
+template <std::size_t Size>
+inline void* alloc() {
+    return detail::sized<Size>::alloc();
+}
+
+// Uninitialized room for a T, from its size class
+template <typename T>
+inline T* alloc() {
+    return static_cast<T*>(detail::sized<sizeof(T)>::alloc());
+}
+
+/**
+ * @class vec
+ * @brief A growable array tracked as a single block, see RcdVec.
+ *
+ * Elements are relocated by resize(), i.e. realloc(), so they must be
+ * trivially copyable. Allocation failures throw std::bad_alloc.
+ */
+template <typename T>
+class vec {
+    static_assert(std::is_trivially_copyable<T>::value, "rcd::vec relocates its elements bitwise");
+
+public:
+    vec() = default;
+
+    vec(const vec&) = delete;
+    vec& operator=(const vec&) = delete;
+
+    vec(vec&& other) noexcept
+        : data_(other.data_), len_(other.len_), cap_(other.cap_) {
+        other.data_ = nullptr;
+        other.len_ = other.cap_ = 0;
+    }
+
+    vec& operator=(vec&& other) noexcept {
+        if (this != &other) {
+            this->~vec();
+            new (this) vec(std::move(other));
+        }
+        return *this;
+    }
+
+    ~vec() {
+        if (data_)
+            drop(data_);
+    }
+
+    void reserve(std::size_t n) {
+        if (n > cap_)
+            grow(n);
+    }
+
+    void push_back(const T& value) {
+        if (__builtin_expect(len_ == cap_, 0))
+            grow(len_ + 1);
+        data_[len_++] = value;
+    }
+
+    void append(const T* values, std::size_t n) {
+        reserve(len_ + n);
+        memcpy(static_cast<void*>(data_ + len_), values, n * sizeof(T));
+        len_ += n;
+    }
+
+    void pop_back() { --len_; }
+    void clear() { len_ = 0; }
+
+    void shrink_to_fit() {
+        void* data = data_;
+        if (rcd_vec_fit(&data, &cap_, len_, sizeof(T)) != 0)
+            throw std::bad_alloc();
+        data_ = static_cast<T*>(data);
+    }
+
+    T& operator[](std::size_t i) { return data_[i]; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    std::size_t size() const { return len_; }
+    std::size_t capacity() const { return cap_; }
+    bool empty() const { return len_ == 0; }
+
+    T* begin() { return data_; }
+    T* end() { return data_ + len_; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + len_; }
+
+private:
+    void grow(std::size_t needed) {
+        void* data = data_;
+        if (rcd_vec_grow(&data, &cap_, needed, sizeof(T)) != 0)
+            throw std::bad_alloc();
+        data_ = static_cast<T*>(data);
+    }
+
+    T* data_ = nullptr;
+    std::size_t len_ = 0;
+    std::size_t cap_ = 0;
+};
+
+}
@@ -0,0 +1,127 @@
+#include "./record.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "./ptrmap.h"
+
+int record_enabled;
+
+static FILE* record_file;
+static pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Logical ids of the live blocks, by address
+static PtrMap record_ids;
+static uint64_t record_next_id;
+
+static void record_write_varint(uint64_t value) {
+    uint8_t bytes[10];
+    size_t count = 0;
+    do {
+        bytes[count] = value & 0x7f;
+        value >>= 7;
+        if (value)
+            bytes[count] |= 0x80;
+        count++;
+    } while (value);
+    fwrite(bytes, 1, count, record_file);
+}
+
+int record_read_varint(FILE* file, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+        if (byte == EOF)
+            return -1;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return 0;
+    }
+    return -1;
+}
+
+int record_start(const char* path) {
+    if (record_file)
+        return -1;
+
+    record_file = fopen(path, "wb");
+    if (record_file == NULL)
+        return -1;
+
+    fwrite(RECORD_MAGIC, 1, RECORD_MAGIC_SIZE, record_file);
+    ptrmap_init(&record_ids, 1024);
+    record_next_id = 0;
+    __atomic_store_n(&record_enabled, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void record_stop() {
+    pthread_mutex_lock(&record_lock);
+    if (record_file) {
+        __atomic_store_n(&record_enabled, 0, __ATOMIC_RELEASE);
+        fclose(record_file);
+        record_file = NULL;
+        ptrmap_free(&record_ids);
+    }
+    pthread_mutex_unlock(&record_lock);
+}
+
+void record_op(RecordOp op, void* ptr, void* from, size_t size) {
+    uint64_t id;
+
+    if (ptr == NULL)
+        return;
+
+    pthread_mutex_lock(&record_lock);
+    if (record_file == NULL) {
+        pthread_mutex_unlock(&record_lock);
+        return;
+    }
+
+    switch (op) {
+        case RECORD_ALLOC:
+            fputc(op, record_file);
+            record_write_varint(size);
+            ptrmap_put(&record_ids, (uintptr_t)ptr, record_next_id++);
+            break;
+
+        // Blocks allocated before recording started are left out
+        case RECORD_DROP:
+            if (!ptrmap_take(&record_ids, (uintptr_t)ptr, &id))
+                break;
+            fputc(op, record_file);
+            record_write_varint(record_next_id - id);
+            break;
+
+        case RECORD_COPY:
+            if (!ptrmap_get(&record_ids, (uintptr_t)from, &id)) {
+                fputc(RECORD_ALLOC, record_file);
+                record_write_varint(size);
+            }
+            else {
+                fputc(op, record_file);
+                record_write_varint(record_next_id - id);
+                record_write_varint(size);
+            }
+            ptrmap_put(&record_ids, (uintptr_t)ptr, record_next_id++);
+            break;
+
+        case RECORD_RESIZE:
+            if (!ptrmap_take(&record_ids, (uintptr_t)from, &id)) {
+                fputc(RECORD_ALLOC, record_file);
+                record_write_varint(size);
+                id = record_next_id++;
+            }
+            else {
+                fputc(op, record_file);
+                record_write_varint(record_next_id - id);
+                record_write_varint(size);
+            }
+            ptrmap_put(&record_ids, (uintptr_t)ptr, id);
+            break;
+
+        default:
+            break;
+    }
+    pthread_mutex_unlock(&record_lock);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Recording layout: RECORD_MAGIC, then one operation after the other, each a
+ * RecordOp byte followed by LEB128 varints:
+ *
+ *   RECORD_ALLOC   size
+ *   RECORD_DROP    distance
+ *   RECORD_COPY    distance size
+ *   RECORD_RESIZE  distance size
+ *
+ * Blocks get logical ids in order of creation by alloc() and copy(), resize()
+ * keeps the id. A block is referred to by its distance to the next id, which
+ * stays small for the short-lived blocks that make up most of a trace.
+ */
+
+#define RECORD_MAGIC "RCDREC\x00\x01"
+#define RECORD_MAGIC_SIZE 8
+
+typedef enum {
+    RECORD_END,
+    RECORD_ALLOC,
+    RECORD_DROP,
+    RECORD_COPY,
+    RECORD_RESIZE,
+} RecordOp;
+
+extern int record_enabled;
+
+/**
+ * @brief Opens a recording and starts recording.
+ *
+ * @param path The recording file, truncated if it exists.
+ * @return 0 on success, -1 on failure.
+ */
+int record_start(const char* path);
+
+/**
+ * @brief Stops recording and flushes the file.
+ */
+void record_stop();
+
+/**
+ * @brief Appends an operation to the recording. Thread-safe.
+ *
+ * @param op The operation.
+ * @param ptr The resulting block, or the dropped one.
+ * @param from The source block of a copy or resize.
+ * @param size The size of the resulting block.
+ */
+void record_op(RecordOp op, void* ptr, void* from, size_t size);
+
+/**
+ * @brief Reads a varint written to a recording.
+ *
+ * @param file The recording.
+ * @param value Receives the value.
+ * @return 0 on success, -1 at the end of the file.
+ */
+int record_read_varint(FILE* file, uint64_t* value);
+
+// Free when recording is off: a single predictable branch
+#define RECORD(op, ptr, from, size)                           \
+    do {                                                      \
+        if (__builtin_expect(record_enabled, 0))              \
+            record_op((op), (ptr), (from), (size));           \
+    } while (0)
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "./avl.h"
+
+/**
+ * @enum RegistryKind
+ * @brief What a tracked block is, and so how it is released.
+ */
+typedef enum {
+    REGISTRY_HEAP,  // A block from malloc()
+    REGISTRY_POOL,  // A RcdPool, along with its chunks
+    REGISTRY_HANDLES,  // The handle table, along with its arena
+    REGISTRY_GUARDED,  // A sampled block, in the guarded pool
+    REGISTRY_COW,  // A block mapped from a memfd, possibly shared with its copies
+} RegistryKind;
+
+/**
+ * @brief Tracks a block, initializing rcd first if needed. O(log2(n))
+ *
+ * @param ptr The block.
+ * @param size The size of the block.
+ * @return The registry node of the block, of kind REGISTRY_HEAP if new, or
+ *         NULL if no node can be allocated.
+ */
+AvlNode* registry_insert(void* ptr, size_t size);
+
+/**
+ * @brief Stops tracking a block. O(log2(n))
+ *
+ * @param ptr The block.
+ * @return The kind of the block, or -1 if it was not tracked.
+ */
+int registry_remove(void* ptr);
+
+/**
+ * @brief Finds the registry node of a block. O(log2(n))
+ *
+ * @param ptr The block.
+ * @return The node, or NULL if the block is not tracked.
+ */
+AvlNode* registry_find(void* ptr);
+
+/**
+ * @brief Calls `fn` for every registry node. O(n)
+ *
+ * @param fn The function to call for each node.
+ * @param ctx Passed to `fn`.
+ */
+void registry_for_each_node(void (*fn)(AvlNode*, void*), void* ctx);
+
+/**
+ * @brief Frees an untracked block according to its kind.
+ *
+ * @param ptr The block.
+ * @param kind The kind of the block.
+ */
+void registry_release(void* ptr, int kind);
@@ -0,0 +1,158 @@
+#include "./signals.h"
+
+#include <string.h>
+
+#include "./guard.h"
+#include "./lib.h"
+
+
+void __display_signal_help() {
+    printf(
+        "\n" HINT_BANNER "Online docs for signal errors:\n\
+ \x1b[2m·\x1b[0m Wikipedia: \x1b[0;4;34mhttps://en.wikipedia.org/wiki/Signal_(IPC)#POSIX_signals\x1b[0m\n\
+ \x1b[2m·\x1b[0m GNU: \x1b[0;4;34mhttps://www.gnu.org/software/libc/manual/html_node/Standard-Signals.html\x1b[0m\n\
+ \x1b[2m·\x1b[0m Linux Man: \x1b[0;4;34mhttps://man7.org/linux/man-pages/man7/signal.7.html\x1b[0m\n"
+    );
+}
+
+void sighup_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mHangup signal received. \x1b[30mThis can occur when the terminal\nthat started the process is closed or disconnected.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigint_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mInteractive attention  signal received.  \x1b[30mThis can occur when\nthe user presses Ctrl+C in the terminal where the process is\nrunning.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigquit_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mQuit signal received. \x1b[30mThis can occur when the user presses\nCtrl+\\ in the terminal where the process is running.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigill_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mIllegal instruction signal received. \x1b[30mThis can occur when the\nprocess  attempts  to  execute    an  invalid   or undefined\ninstruction.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigtrap_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mTrace/breakpoint trap signal received. \x1b[30mThis can occur when\nthe process hits a breakpoint set by a debugger.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigabrt_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mAbnormal termination signal received. \x1b[30mThis can occur when\nthe process  is terminated  abnormally,  such as  when it\nencounters an unrecoverable error.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigfpe_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mErroneous  arithmetic operation  signal  received. \x1b[30mThis can\noccur  when the process  attempts  to  perform   an invalid\narithmetic operation.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigsegv_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mInvalid access  to storage  signal  received. \x1b[30mThis can occur\nwhen the process attempts to access  memory  that it  is not\nallowed to access.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigsegv_action(int signal, siginfo_t* info, void* context) {
+    guard_report(info->si_addr);
+    sigsegv_handler(signal);
+}
+
+void sigpipe_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mBroken pipe signal received. \x1b[30mThis can occur when the process\nwrites to a pipe that has been closed by the other end.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigalrm_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mAlarm clock signal received. \x1b[30mThis can occur when a timer set\nby the process expires.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+void sigterm_handler(int signal) {
+    printf("\n" ERROR_BANNER "\x1b[31mTermination request signal received. \x1b[30mThis can occur when the\nprocess is requested to terminate cleanly.\x1b[0m\n");
+    __display_signal_help();
+    exit(signal);
+}
+
+typedef struct {
+    const char* name;
+    int signum;
+    int mask;
+    void (*handler)(int);
+    void (*action)(int, siginfo_t*, void*);
+} SignalEntry;
+
+static const SignalEntry signal_entries[] = {
+    { "hup", SIGHUP, RCD_SIGNAL_HUP, sighup_handler },
+    { "int", SIGINT, RCD_SIGNAL_INT, sigint_handler },
+    { "quit", SIGQUIT, RCD_SIGNAL_QUIT, sigquit_handler },
+    { "ill", SIGILL, RCD_SIGNAL_ILL, sigill_handler },
+    { "trap", SIGTRAP, RCD_SIGNAL_TRAP, sigtrap_handler },
+    { "abrt", SIGABRT, RCD_SIGNAL_ABRT, sigabrt_handler },
+    { "fpe", SIGFPE, RCD_SIGNAL_FPE, sigfpe_handler },
+    { "segv", SIGSEGV, RCD_SIGNAL_SEGV, sigsegv_handler, sigsegv_action },
+    { "pipe", SIGPIPE, RCD_SIGNAL_PIPE, sigpipe_handler },
+    { "alrm", SIGALRM, RCD_SIGNAL_ALRM, sigalrm_handler },
+    { "term", SIGTERM, RCD_SIGNAL_TERM, sigterm_handler },
+};
+
+#define SIGNAL_ENTRIES (sizeof(signal_entries) / sizeof(signal_entries[0]))
+
+void signals_install(int mask) {
+    for (size_t i = 0; i < SIGNAL_ENTRIES; i++) {
+        if (!(mask & signal_entries[i].mask))
+            continue;
+
+        struct sigaction current;
+        if (sigaction(signal_entries[i].signum, NULL, &current) != 0 || current.sa_handler != SIG_DFL)
+            continue;
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        if (signal_entries[i].action) {
+            action.sa_sigaction = signal_entries[i].action;
+            action.sa_flags = SA_SIGINFO;
+        }
+        else {
+            action.sa_handler = signal_entries[i].handler;
+        }
+        sigemptyset(&action.sa_mask);
+        sigaction(signal_entries[i].signum, &action, NULL);
+    }
+}
+
+int signals_parse(const char* names) {
+    if (strcmp(names, "all") == 0)
+        return RCD_SIGNALS_ALL;
+    if (strcmp(names, "none") == 0)
+        return 0;
+
+    int mask = 0;
+    while (*names) {
+        size_t length = strcspn(names, ",");
+        size_t i = 0;
+        while (i < SIGNAL_ENTRIES &&
+            (strlen(signal_entries[i].name) != length || strncmp(signal_entries[i].name, names, length) != 0))
+            i++;
+        if (i == SIGNAL_ENTRIES)
+            return -1;
+
+        mask |= signal_entries[i].mask;
+        names += length;
+        if (*names == ',')
+            names++;
+    }
+    return mask;
+}
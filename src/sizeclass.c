@@ -0,0 +1,216 @@
+#include "./sizeclass.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/*
+ * Threads start with full caches, so that their first drop() goes through
+ * rcd_class_flush() and links them like their first rcd_class_refill() does.
+ * A linked thread hands its objects back when it exits.
+ */
+__thread RcdClassCache rcd_class_caches[RCD_CLASSES] = {
+    [0 ... RCD_CLASSES - 1] = { .count = RCD_CLASS_CACHE_MAX },
+};
+uintptr_t rcd_class_base = (uintptr_t)0 - RCD_CLASS_REGION;
+int rcd_class_bypass;
+
+// Bytes carved from each arena so far
+static size_t sizeclass_tops[RCD_CLASSES];
+// Objects handed back by the threads, for any of them to take
+static void* sizeclass_lists[RCD_CLASSES];
+
+static SizeclassThread* sizeclass_threads;
+static __thread SizeclassThread sizeclass_self;
+static pthread_key_t sizeclass_key;
+
+// 1 once the region is reserved, -1 if it can't be
+static int sizeclass_state;
+static pthread_mutex_t sizeclass_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void sizeclass_thread_exit(void* self);
+
+// Reserves the region and links the calling thread, under the lock
+static int sizeclass_attach() {
+    if (sizeclass_state == 0) {
+        void* region = mmap(NULL, SIZECLASS_MAPPING, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (region == MAP_FAILED || pthread_key_create(&sizeclass_key, sizeclass_thread_exit) != 0) {
+            if (region != MAP_FAILED)
+                munmap(region, SIZECLASS_MAPPING);
+            sizeclass_state = -1;
+        }
+        else {
+            __atomic_store_n(&rcd_class_base, (uintptr_t)region, __ATOMIC_RELEASE);
+            sizeclass_state = 1;
+        }
+    }
+    if (sizeclass_state < 0)
+        return -1;
+
+    if (sizeclass_self.caches == NULL) {
+        sizeclass_self.caches = rcd_class_caches;
+        sizeclass_self.prev = NULL;
+        sizeclass_self.next = sizeclass_threads;
+        if (sizeclass_threads)
+            sizeclass_threads->prev = &sizeclass_self;
+        sizeclass_threads = &sizeclass_self;
+        pthread_setspecific(sizeclass_key, &sizeclass_self);
+    }
+    return 0;
+}
+
+// Hands a freelist back, under the lock
+static void sizeclass_give(unsigned cls, void* head, void* tail) {
+    if (head == NULL)
+        return;
+
+    *(void**)tail = sizeclass_lists[cls];
+    sizeclass_lists[cls] = head;
+}
+
+static void sizeclass_thread_exit(void* self) {
+    SizeclassThread* thread = (SizeclassThread*)self;
+
+    pthread_mutex_lock(&sizeclass_lock);
+    for (unsigned cls = 0; cls < RCD_CLASSES; cls++) {
+        RcdClassCache* cache = &thread->caches[cls];
+        size_t obj_size = RCD_CLASS_SIZE(cls);
+
+        // The rest of the chunk goes back along with the freelist
+        while (cache->next < cache->end) {
+            *(void**)cache->next = cache->free;
+            cache->free = cache->next;
+            cache->next += obj_size;
+        }
+
+        void* tail = cache->free;
+        while (tail && *(void**)tail)
+            tail = *(void**)tail;
+        sizeclass_give(cls, cache->free, tail);
+
+        cache->free = NULL;
+        cache->next = cache->end = NULL;
+        cache->count = RCD_CLASS_CACHE_MAX;
+    }
+
+    if (thread->prev)
+        thread->prev->next = thread->next;
+    else
+        sizeclass_threads = thread->next;
+    if (thread->next)
+        thread->next->prev = thread->prev;
+    thread->caches = NULL;
+    pthread_mutex_unlock(&sizeclass_lock);
+}
+
+void* rcd_class_refill(unsigned cls, size_t size) {
+    RcdClassCache* cache = &rcd_class_caches[cls];
+    size_t obj_size = RCD_CLASS_SIZE(cls);
+    void* obj = NULL;
+
+    pthread_mutex_lock(&sizeclass_lock);
+    if (sizeclass_attach() == 0) {
+        obj = sizeclass_lists[cls];
+        if (obj) {
+            // A batch of the objects handed back, the first one is returned
+            void* last = obj;
+            size_t taken = 1;
+            while (taken < SIZECLASS_BATCH && *(void**)last) {
+                last = *(void**)last;
+                taken++;
+            }
+            sizeclass_lists[cls] = *(void**)last;
+            *(void**)last = NULL;
+
+            cache->free = *(void**)obj;
+            cache->count = taken - 1;
+        }
+        else {
+            // A new chunk, carved lazily by rcd_class_alloc()
+            size_t chunk = SIZECLASS_CHUNK / obj_size * obj_size;
+            size_t top = sizeclass_tops[cls];
+            if (top + chunk <= (1ul << RCD_CLASS_ARENA_SHIFT)) {
+                obj = (char*)rcd_class_base + ((uintptr_t)cls << RCD_CLASS_ARENA_SHIFT) + top;
+                __atomic_store_n(&sizeclass_tops[cls], top + chunk, __ATOMIC_RELAXED);
+                cache->next = (char*)obj + obj_size;
+                cache->end = (char*)obj + chunk;
+                cache->count = 0;
+            }
+        }
+    }
+    pthread_mutex_unlock(&sizeclass_lock);
+
+    // Without the region or once the arena is full, the heap takes over
+    if (obj == NULL)
+        return alloc(size);
+
+    *RCD_CLASS_LIVE((uintptr_t)obj - rcd_class_base) = 1;
+    return obj;
+}
+
+void rcd_class_flush(RcdClassCache* cache) {
+    unsigned cls = (unsigned)(cache - rcd_class_caches);
+    void* head = cache->free;
+    void* tail = head;
+    while (*(void**)tail)
+        tail = *(void**)tail;
+
+    cache->free = NULL;
+    cache->count = 0;
+
+    pthread_mutex_lock(&sizeclass_lock);
+    sizeclass_attach();
+    sizeclass_give(cls, head, tail);
+    pthread_mutex_unlock(&sizeclass_lock);
+}
+
+size_t sizeclass_size(const void* addr) {
+    uintptr_t offset = (uintptr_t)addr - rcd_class_base;
+    return offset < RCD_CLASS_REGION ?
+        RCD_CLASS_SIZE(offset >> RCD_CLASS_ARENA_SHIFT) : 0;
+}
+
+int sizeclass_owner(const void* addr, void** base, size_t* size) {
+    uintptr_t offset = (uintptr_t)addr - rcd_class_base;
+    if (offset >= RCD_CLASS_REGION)
+        return 0;
+
+    unsigned cls = (unsigned)(offset >> RCD_CLASS_ARENA_SHIFT);
+    size_t obj_size = RCD_CLASS_SIZE(cls);
+    size_t in_arena = offset & ((1ul << RCD_CLASS_ARENA_SHIFT) - 1);
+    if (in_arena >= __atomic_load_n(&sizeclass_tops[cls], __ATOMIC_RELAXED))
+        return 0;
+
+    size_t start = offset - in_arena % obj_size;
+    if (!*RCD_CLASS_LIVE(start))
+        return 0;
+
+    if (base)
+        *base = (char*)rcd_class_base + start;
+    if (size)
+        *size = obj_size;
+    return 1;
+}
+
+void sizeclass_put(void* ptr) {
+    uintptr_t offset = (uintptr_t)ptr - rcd_class_base;
+    RcdClassCache* cache = &rcd_class_caches[offset >> RCD_CLASS_ARENA_SHIFT];
+    *RCD_CLASS_LIVE(offset) = 0;
+    *(void**)ptr = cache->free;
+    cache->free = ptr;
+    if (++cache->count > RCD_CLASS_CACHE_MAX)
+        rcd_class_flush(cache);
+}
+
+void sizeclass_reset() {
+    pthread_mutex_lock(&sizeclass_lock);
+    if (sizeclass_state > 0) {
+        for (SizeclassThread* thread = sizeclass_threads; thread; thread = thread->next)
+            memset(thread->caches, 0, RCD_CLASSES * sizeof(RcdClassCache));
+        memset(sizeclass_tops, 0, sizeof(sizeclass_tops));
+        memset(sizeclass_lists, 0, sizeof(sizeclass_lists));
+        madvise((void*)rcd_class_base, SIZECLASS_MAPPING, MADV_DONTNEED);
+    }
+    pthread_mutex_unlock(&sizeclass_lock);
+}
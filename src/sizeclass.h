@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "./lib.h"
+
+// Objects a thread takes at once from the ones handed back
+#define SIZECLASS_BATCH 128
+// Bytes a thread carves at once from an arena
+#define SIZECLASS_CHUNK (64ul << 10)
+
+// The arenas, followed by the liveness bytes of their granules
+#define SIZECLASS_MAPPING (RCD_CLASS_REGION + RCD_CLASS_REGION / RCD_CLASS_GRANULE)
+
+/**
+ * @struct SizeclassThread
+ * @brief Links the caches of a thread, so that quit() can empty them.
+ */
+typedef struct SizeclassThread {
+    RcdClassCache* caches;
+    struct SizeclassThread* prev;
+    struct SizeclassThread* next;
+} SizeclassThread;
+
+/**
+ * @brief Gets the size of the class an address belongs to. O(1)
+ *
+ * @param addr Any address.
+ * @return The size of the objects of its class, or 0 outside of the region.
+ */
+size_t sizeclass_size(const void* addr);
+
+/**
+ * @brief Finds the live object of a size class containing an address. O(1)
+ *
+ * @param addr An address in the region.
+ * @param base Receives the start of the object, may be NULL.
+ * @param size Receives the size of its class, may be NULL.
+ * @return 1 if the object is live, 0 otherwise.
+ */
+int sizeclass_owner(const void* addr, void** base, size_t* size);
+
+/**
+ * @brief Recycles an object of a size class into the caches of the thread.
+ *
+ * @param ptr The object.
+ */
+void sizeclass_put(void* ptr);
+
+/**
+ * @brief Empties the caches of every thread and gives the region back to the OS.
+ *
+ * No other thread may use the size classes meanwhile.
+ */
+void sizeclass_reset();
@@ -0,0 +1,130 @@
+#include "./trace.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+int trace_enabled;
+
+static TraceHeader* trace_header;
+static size_t trace_length;
+static uint64_t trace_ns_start;
+
+// Incremented by trace_start(), so that threads drop chunks of older traces
+static uint32_t trace_session;
+
+// The chunk being filled by the current thread
+static __thread TraceEvent* trace_next __attribute__((tls_model("initial-exec")));
+static __thread TraceEvent* trace_end __attribute__((tls_model("initial-exec")));
+static __thread uint32_t trace_tid __attribute__((tls_model("initial-exec")));
+static __thread uint32_t trace_thread_session __attribute__((tls_model("initial-exec")));
+
+static uint64_t trace_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static inline uint64_t trace_clock() {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return trace_ns();
+#endif
+}
+
+// Measures the clock against CLOCK_MONOTONIC since the start of the trace
+static void trace_calibrate() {
+    uint64_t ns = trace_ns() - trace_ns_start;
+    uint64_t ticks = trace_clock() - trace_header->tsc_start;
+    if (ns > 0)
+        trace_header->tsc_per_us = (double)ticks * 1000.0 / (double)ns;
+}
+
+int trace_start(const char* path, size_t size) {
+    if (trace_header)
+        return -1;
+
+    if (size < sizeof(TraceHeader))
+        return -1;
+    size_t capacity = (size - sizeof(TraceHeader)) / sizeof(TraceEvent);
+    capacity -= capacity % TRACE_CHUNK;
+    if (capacity == 0)
+        return -1;
+    size = sizeof(TraceHeader) + capacity * sizeof(TraceEvent);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    trace_header = (TraceHeader*)map;
+    trace_length = size;
+    memcpy(trace_header->magic, TRACE_MAGIC, sizeof(trace_header->magic));
+    trace_header->version = TRACE_VERSION;
+    trace_header->event_size = sizeof(TraceEvent);
+    trace_header->capacity = capacity;
+    trace_header->cursor = 0;
+    trace_session++;
+
+    // Provisional calibration, in case trace_stop() never runs
+    trace_ns_start = trace_ns();
+    trace_header->tsc_start = trace_clock();
+    while (trace_ns() - trace_ns_start < 1000000);
+    trace_calibrate();
+
+    __atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void trace_stop(int unmap) {
+    TraceHeader* header = trace_header;
+    if (header == NULL)
+        return;
+
+    __atomic_store_n(&trace_enabled, 0, __ATOMIC_RELEASE);
+    trace_calibrate();
+    __atomic_store_n(&trace_header, NULL, __ATOMIC_RELEASE);
+
+    // The file keeps the events, the descriptor was closed once mapped
+    msync(header, sizeof(TraceHeader), MS_ASYNC);
+    if (unmap)
+        munmap(header, trace_length);
+}
+
+void trace_record(TraceOp op, void* ptr, void* from, size_t size) {
+    TraceHeader* header = trace_header;
+    if (header == NULL)
+        return;
+
+    if (trace_next == trace_end || trace_thread_session != trace_session) {
+        uint64_t start = __atomic_fetch_add(&header->cursor, TRACE_CHUNK, __ATOMIC_RELAXED);
+        trace_next = (TraceEvent*)(header + 1) + start % header->capacity;
+        trace_end = trace_next + TRACE_CHUNK;
+        trace_thread_session = trace_session;
+        if (trace_tid == 0)
+            trace_tid = (uint32_t)syscall(SYS_gettid);
+    }
+
+    TraceEvent* event = trace_next++;
+    event->tsc = trace_clock();
+    event->ptr = (uint64_t)(uintptr_t)ptr;
+    event->from = (uint64_t)(uintptr_t)from;
+    event->size = size;
+    event->tid = trace_tid;
+    event->op = op;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Trace file layout: a TraceHeader followed by `capacity` TraceEvents used as
+ * a ring. Threads claim TRACE_CHUNK events at a time by bumping `cursor`, then
+ * write them without synchronization. Unwritten events have op TRACE_NONE.
+ */
+
+#define TRACE_MAGIC "RCDTRACE"
+#define TRACE_VERSION 1
+
+// Events claimed at once by a thread
+#define TRACE_CHUNK 256
+
+// Used when RcdConfig.trace_size is 0
+#define TRACE_DEFAULT_SIZE (64ul << 20)
+
+typedef enum {
+    TRACE_NONE,
+    TRACE_ALLOC,
+    TRACE_DROP,
+    TRACE_COPY,
+    TRACE_RESIZE,
+} TraceOp;
+
+/**
+ * @struct TraceEvent
+ * @brief One traced operation.
+ *
+ * `from` is the source block of a copy or resize, `size` the size of the
+ * resulting block (or of the dropped one).
+ * Size: 40 bytes
+ */
+typedef struct {
+    uint64_t tsc;
+    uint64_t ptr;
+    uint64_t from;
+    uint64_t size;
+    uint32_t tid;
+    uint32_t op;
+} TraceEvent;
+
+/**
+ * @struct TraceHeader
+ * @brief The header of a trace file.
+ *
+ * `cursor` counts the events claimed so far, it goes past `capacity` once the
+ * ring has wrapped. `tsc_per_us` converts timestamps to microseconds since
+ * `tsc_start`.
+ * Size: 64 bytes
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t event_size;
+    uint64_t capacity;
+    uint64_t cursor;
+    uint64_t tsc_start;
+    double tsc_per_us;
+    uint8_t padding[16];
+} TraceHeader;
+
+extern int trace_enabled;
+
+/**
+ * @brief Maps a new trace file and starts tracing.
+ *
+ * @param path The trace file, truncated if it exists.
+ * @param size The size of the file, the ring holds as many events as fit.
+ * @return 0 on success, -1 on failure.
+ */
+int trace_start(const char* path, size_t size);
+
+/**
+ * @brief Stops tracing and writes the final clock calibration.
+ *
+ * @param unmap 1 to unmap the ring, when no other thread may still be
+ * writing to its chunk, 0 to leave it to the OS at exit.
+ */
+void trace_stop(int unmap);
+
+/**
+ * @brief Appends an event to the calling thread's chunk.
+ */
+void trace_record(TraceOp op, void* ptr, void* from, size_t size);
+
+// Free when tracing is off: a single predictable branch
+#define TRACE(op, ptr, from, size)                            \
+    do {                                                      \
+        if (__builtin_expect(trace_enabled, 0))               \
+            trace_record((op), (ptr), (from), (size));        \
+    } while (0)
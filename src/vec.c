@@ -0,0 +1,42 @@
+#include "./vec.h"
+
+#include <stdint.h>
+
+
+int rcd_vec_grow(void** data, size_t* cap, size_t needed, size_t elem_size) {
+    size_t new_cap = *cap ?
+        *cap * 2 : RCD_VEC_MIN_CAP;
+    if (new_cap < needed)
+        new_cap = needed;
+    if (new_cap > SIZE_MAX / elem_size)
+        return -1;
+
+    void* new_data = *data ?
+        resize(*data, new_cap * elem_size) : alloc(new_cap * elem_size);
+    if (new_data == NULL)
+        return -1;
+
+    *data = new_data;
+    *cap = new_cap;
+    return 0;
+}
+
+int rcd_vec_fit(void** data, size_t* cap, size_t len, size_t elem_size) {
+    if (*data == NULL || len == *cap)
+        return 0;
+
+    if (len == 0) {
+        drop(*data);
+        *data = NULL;
+        *cap = 0;
+        return 0;
+    }
+
+    void* new_data = resize(*data, len * elem_size);
+    if (new_data == NULL)
+        return -1;
+
+    *data = new_data;
+    *cap = len;
+    return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string.h>
+
+#include "./lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A growable array, tracked as a single block. Capacity grows geometrically
+ * through resize(), which extends the block in place whenever it can.
+ *
+ *     typedef RcdVec(int) IntVec;
+ *     IntVec v;
+ *     rcd_vec_init(&v);
+ *     rcd_vec_push(&v, 42);
+ *     rcd_vec_free(&v);
+ */
+
+#define RcdVec(T)    \
+    struct {         \
+        T* data;     \
+        size_t len;  \
+        size_t cap;  \
+    }
+
+// Capacity of the first block, in elements
+#define RCD_VEC_MIN_CAP 8
+
+/**
+ * @brief Grows the capacity of a vector to at least `needed` elements.
+ *
+ * The capacity is at least doubled, so pushes are amortized O(1).
+ *
+ * @return 0 on success, -1 if the block cannot grow.
+ */
+RCD_API int rcd_vec_grow(void** data, size_t* cap, size_t needed, size_t elem_size);
+
+/**
+ * @brief Shrinks the block of a vector to its length.
+ *
+ * @return 0 on success, -1 if the block cannot be resized.
+ */
+RCD_API int rcd_vec_fit(void** data, size_t* cap, size_t len, size_t elem_size);
+
+#define rcd_vec_init(v) \
+    ((v)->data = NULL, (v)->len = 0, (v)->cap = 0)
+
+#define rcd_vec_free(v) \
+    ((v)->data ? drop((v)->data) : (void)0, rcd_vec_init(v))
+
+#define rcd_vec_reserve(v, n)                                                          \
+    ((n) <= (v)->cap ?                                                                 \
+        0 : rcd_vec_grow((void**)&(v)->data, &(v)->cap, (n), sizeof(*(v)->data)))
+
+// Appends an element, evaluates to 0 or -1 if the array can't grow
+#define rcd_vec_push(v, x)                                                             \
+    (__builtin_expect((v)->len < (v)->cap, 1) ||                                       \
+        rcd_vec_grow((void**)&(v)->data, &(v)->cap, (v)->len + 1, sizeof(*(v)->data)) == 0 ? \
+        ((v)->data[(v)->len++] = (x), 0) : -1)
+
+// Appends `n` elements with a single memcpy, evaluates to 0 or -1
+#define rcd_vec_append(v, src, n)                                                      \
+    (rcd_vec_reserve((v), (v)->len + (n)) == 0 ?                                       \
+        (memcpy((v)->data + (v)->len, (src), (n) * sizeof(*(v)->data)), (v)->len += (n), 0) : -1)
+
+#define rcd_vec_pop(v) \
+    ((v)->data[--(v)->len])
+
+#define rcd_vec_clear(v) \
+    ((v)->len = 0)
+
+#define rcd_vec_shrink_to_fit(v) \
+    rcd_vec_fit((void**)&(v)->data, &(v)->cap, (v)->len, sizeof(*(v)->data))
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/lib.h"
+
+
+static int soft_calls;
+
+static void on_soft_limit(RcdBudget* budget, size_t used, void* ctx) {
+    assert(used >= 1000 && ctx == &soft_calls);
+    soft_calls++;
+}
+
+int main() {
+    RcdBudget* tenant = rcd_budget_create("tenant", 1000, 4000, on_soft_limit, &soft_calls);
+    assert(rcd_budget_set(tenant) == NULL);
+    assert(rcd_budget_get() == tenant);
+
+    char* blocks[6];
+    for (int i = 0; i < 6; i++)
+        blocks[i] = (char*)alloc(500);
+    assert(rcd_budget_used(tenant) == 3000);
+    assert(soft_calls == 1);
+
+    // Past the hard limit, alloc() fails without allocating
+    assert(alloc(1500) == NULL);
+    assert(rcd_budget_used(tenant) == 3000);
+
+    // Charges follow the blocks across resize() and copy()
+    blocks[0] = (char*)resize(blocks[0], 1000);
+    assert(rcd_budget_used(tenant) == 3500);
+    assert(resize(blocks[0], 2000) == NULL);
+    blocks[1] = (char*)resize(blocks[1], 100);
+    assert(rcd_budget_used(tenant) == 3100);
+
+    char* copied = (char*)copy(blocks[2], 500);
+    assert(rcd_budget_used(tenant) == 3600);
+
+    // Blocks are given back to their owner, whichever thread drops them
+    assert(rcd_budget_set(NULL) == tenant);
+    char* unbudgeted = (char*)alloc(10000);
+    assert(rcd_budget_used(tenant) == 3600);
+    drop(copied);
+    drop(unbudgeted);
+    assert(rcd_budget_used(tenant) == 3100);
+
+    for (int i = 0; i < 6; i++)
+        drop(blocks[i]);
+    assert(rcd_budget_used(tenant) == 0);
+
+    // The soft limit calls back again once crossed anew
+    rcd_budget_set(tenant);
+    char* again = (char*)alloc(1200);
+    assert(soft_calls == 2);
+    rcd_budget_set(NULL);
+
+    printf("%s: %zu bytes\n", rcd_budget_name(tenant), rcd_budget_used(tenant));
+    rcd_budget_destroy(tenant);
+    drop(again);
+}
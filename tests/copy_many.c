@@ -0,0 +1,38 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib.h"
+
+
+int main() {
+    // Large blocks come from malloc(), even with RCD_COW_THRESHOLD set
+    RcdConfig config = rcd_config_from_env();
+    config.cow_threshold = 0;
+    assert(rcd_init(&config) == 0);
+
+    int* blocks[1024];
+    for (int i = 0; i < 1024; i++) {
+        blocks[i] = (int*)alloc(sizeof(int) * (i + 1));
+        for (int j = 0; j <= i; j++)
+            blocks[i][j] = i + j;
+    }
+
+    int* copies[1024];
+    copy_many((void**)copies, (void* const*)blocks, 1024);
+
+    for (int i = 0; i < 1024; i++) {
+        assert(copies[i] != blocks[i]);
+        for (int j = 0; j <= i; j++)
+            assert(copies[i][j] == i + j);
+    }
+
+    // Large enough to take the streaming path
+    size_t size = 64 << 20;
+    char* big = (char*)alloc(size);
+    memset(big, 7, size);
+    char* big_copy = (char*)copy(big, size);
+    assert(memcmp(big, big_copy, size) == 0);
+
+    printf("copies[1023][1023]: %d\n", copies[1023][1023]);
+}
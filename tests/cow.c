@@ -0,0 +1,51 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/lib.h"
+
+#define SIZE (64ul << 20)
+
+
+static size_t resident_bytes() {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    size_t pages = 0, resident = 0;
+    assert(fscanf(statm, "%zu %zu", &pages, &resident) == 2);
+    fclose(statm);
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+int main() {
+    RcdConfig config = rcd_config_from_env();
+    config.cow_threshold = SIZE;
+    assert(rcd_init(&config) == 0);
+
+    char* original = (char*)alloc(SIZE);
+    memset(original, 'a', SIZE);
+
+    // The snapshot shares every page it doesn't write to
+    size_t before = resident_bytes();
+    char* snapshot = (char*)copy(original, SIZE);
+    assert(resident_bytes() < before + SIZE / 8);
+    assert(snapshot[0] == 'a' && snapshot[SIZE - 1] == 'a');
+
+    // Writes stay in the block that makes them
+    original[0] = 'b';
+    snapshot[SIZE - 1] = 'c';
+    assert(snapshot[0] == 'a' && original[SIZE - 1] == 'a');
+
+    // A later copy sees the pages written since the first one
+    char* second = (char*)copy(original, SIZE);
+    assert(second[0] == 'b' && second[1] == 'a' && second[SIZE - 1] == 'a');
+
+    // Other sizes are copied as before
+    char* shorter = (char*)copy(original, SIZE / 2);
+    assert(shorter[0] == 'b' && shorter[SIZE / 2 - 1] == 'a');
+
+    printf("snapshot[0]: %c, original[0]: %c\n", snapshot[0], original[0]);
+    drop(original);
+    drop(shorter);
+    drop(snapshot);
+    assert(second[SIZE / 2] == 'a');
+}
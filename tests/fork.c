@@ -0,0 +1,31 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/lib.h"
+
+#define SIZE (128ul << 20)
+
+
+int main() {
+    // Large blocks are private to the process by default, as malloc() ones
+    char* block = (char*)alloc(SIZE);
+    memset(block, 'P', SIZE);
+
+    pid_t child = fork();
+    assert(child >= 0);
+    if (child == 0) {
+        block[0] = 'C';
+        _exit(block[0] == 'C' ? 0 : 1);
+    }
+
+    int status;
+    assert(waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(block[0] == 'P');
+
+    printf("parent sees %c\n", block[0]);
+    drop(block);
+}
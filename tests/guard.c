@@ -0,0 +1,66 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/lib.h"
+
+
+// Runs `fault` in a child, which must die through the SIGSEGV handler
+static void expect_fault(void (*fault)(char*), char* block) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fault(block);
+        _exit(0);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == SIGSEGV);
+}
+
+static void overflow(char* block) {
+    block[32] = 1;
+}
+
+static void use_after_free(char* block) {
+    block[0] = 1;
+}
+
+int main() {
+    RcdConfig config = rcd_config_from_env();
+    config.signals = RCD_SIGNAL_SEGV;
+    config.sample_rate = 1;
+    config.guard_slots = 4;
+    assert(rcd_init(&config) == 0);
+
+    // Sampled blocks end against a guard page
+    long page = sysconf(_SC_PAGESIZE);
+    char* blocks[4];
+    for (int i = 0; i < 4; i++) {
+        blocks[i] = (char*)alloc(32);
+        assert(((uintptr_t)(blocks[i] + 32) & (page - 1)) == 0);
+        blocks[i][31] = (char)i;
+    }
+
+    // Once the pages are taken, alloc() goes back to malloc()
+    char* fallback = (char*)alloc(32);
+    assert(((uintptr_t)(fallback + 32) & (page - 1)) != 0);
+    drop(fallback);
+
+    expect_fault(overflow, blocks[0]);
+
+    drop(blocks[1]);
+    expect_fault(use_after_free, blocks[1]);
+
+    // A block larger than a page is never sampled
+    char* large = (char*)alloc(page + 1);
+    large[page] = 1;
+
+    char* resized = (char*)resize(blocks[2], 64);
+    assert(resized[31] == 2);
+
+    printf("blocks[3][31]: %d\n", blocks[3][31]);
+}
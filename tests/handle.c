@@ -0,0 +1,55 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib.h"
+
+
+int main() {
+    RcdHandle handles[1000];
+    for (int i = 0; i < 1000; i++) {
+        handles[i] = rcd_handle_alloc(100 + i);
+        assert(handles[i] != RCD_HANDLE_NULL);
+
+        char* data = (char*)rcd_handle_get(handles[i]);
+        assert(((size_t)data & 15) == 0);
+        memset(data, i & 0xff, 100 + i);
+    }
+
+    // Dropped handles are detected, even once their slot is reused
+    RcdHandle stale = handles[500];
+    rcd_handle_drop(stale);
+    assert(rcd_handle_get(stale) == NULL);
+    handles[500] = rcd_handle_alloc(8);
+    assert(handles[500] != stale);
+    assert(rcd_handle_get(stale) == NULL);
+    rcd_handle_drop(stale);
+    assert(rcd_handle_get(handles[500]) != NULL);
+
+    for (int i = 0; i < 1000; i += 2)
+        rcd_handle_drop(handles[i]);
+
+    // Compaction moves the blocks but keeps their content
+    char* before = (char*)rcd_handle_get(handles[999]);
+    size_t released = rcd_compact();
+    char* after = (char*)rcd_handle_get(handles[999]);
+    assert(after < before);
+    assert(released > 0);
+    for (int i = 1; i < 1000; i += 2) {
+        unsigned char* data = (unsigned char*)rcd_handle_get(handles[i]);
+        for (int j = 0; j < 100 + i; j++)
+            assert(data[j] == (i & 0xff));
+    }
+    assert(rcd_compact() == 0);
+
+    printf("Released by rcd_compact(): %zu bytes\n", released);
+
+    // Handles left alive are reclaimed by quit(), and don't match the new slots
+    quit();
+    assert(rcd_handle_get(handles[1]) == NULL);
+    RcdHandle first = rcd_handle_alloc(64);
+    RcdHandle second = rcd_handle_alloc(64);
+    assert(rcd_handle_get(first) != NULL && rcd_handle_get(second) != NULL);
+    assert((uint32_t)second == (uint32_t)handles[1]);
+    assert(rcd_handle_get(handles[0]) == NULL && rcd_handle_get(handles[1]) == NULL);
+}
@@ -0,0 +1,34 @@
+#include <assert.h>
+#include <signal.h>
+
+#include "../src/lib.h"
+
+
+static void own_handler(int signal) {}
+
+int main() {
+    struct sigaction action;
+
+    // Nothing is installed before rcd is used
+    sigaction(SIGSEGV, NULL, &action);
+    assert(action.sa_handler == SIG_DFL);
+
+    // Handlers installed by the program are kept
+    signal(SIGTERM, own_handler);
+
+    RcdConfig config = rcd_config_from_env();
+    config.signals = RCD_SIGNALS_FAULTS | RCD_SIGNAL_TERM;
+    assert(rcd_init(&config) == 0);
+    assert(rcd_init(NULL) == -1);
+
+    sigaction(SIGSEGV, NULL, &action);
+    assert(action.sa_handler != SIG_DFL);
+    sigaction(SIGTERM, NULL, &action);
+    assert(action.sa_handler == own_handler);
+    sigaction(SIGINT, NULL, &action);
+    assert(action.sa_handler == SIG_DFL);
+
+    int* ptr = (int*)alloc(sizeof(int));
+    drop(ptr);
+    alloc(sizeof(int));
+}
@@ -0,0 +1,57 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/lib.h"
+
+
+typedef struct {
+    char* blocks[64];
+    size_t count;
+} Visited;
+
+static void visit(void* base, size_t size, void* ctx) {
+    Visited* visited = (Visited*)ctx;
+    assert(visited->count == 0 || (char*)base > visited->blocks[visited->count - 1]);
+    visited->blocks[visited->count++] = (char*)base;
+}
+
+int main() {
+    char* blocks[64];
+    for (int i = 0; i < 64; i++)
+        blocks[i] = (char*)alloc(32 + i);
+
+    // Interior pointers map back to their block
+    for (int i = 0; i < 64; i++) {
+        void* base;
+        size_t size;
+        assert(rcd_owner(blocks[i], &base, &size) && base == blocks[i] && size == (size_t)(32 + i));
+        assert(rcd_owner(blocks[i] + 31 + i, &base, NULL) && base == blocks[i]);
+    }
+
+    int dummy;
+    assert(!rcd_owner(&dummy, NULL, NULL));
+
+    // Dropped blocks are no longer owners
+    drop(blocks[63]);
+    assert(!rcd_owner(blocks[63], NULL, NULL));
+    assert(!rcd_owner(blocks[63] + 10, NULL, NULL));
+
+    // A range starting inside a block includes it
+    char* lowest = blocks[0];
+    char* highest = blocks[0];
+    for (int i = 1; i < 63; i++) {
+        lowest = blocks[i] < lowest ? blocks[i] : lowest;
+        highest = blocks[i] > highest ? blocks[i] : highest;
+    }
+
+    Visited visited = { .count = 0 };
+    rcd_for_each_in_range(lowest + 1, highest + 1, visit, &visited);
+    assert(visited.count == 63);
+    assert(visited.blocks[0] == lowest);
+
+    visited.count = 0;
+    rcd_for_each_in_range(lowest + 1, highest, visit, &visited);
+    assert(visited.count == 62);
+
+    printf("visited: %zu\n", visited.count);
+}
@@ -0,0 +1,89 @@
+#include <assert.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../src/lib.h"
+
+#define HEAP_PATH "target/tests/persist.heap"
+#define JOURNAL_PATH HEAP_PATH ".journal"
+
+
+typedef struct Node {
+    struct Node* next;
+    int value;
+} Node;
+
+typedef struct {
+    Node* head;
+    int count;
+} List;
+
+static void count_blocks(void* base, size_t size, void* ctx) {
+    (*(int*)ctx)++;
+}
+
+static int sum(const List* list) {
+    int total = 0;
+    for (Node* node = list->head; node; node = node->next)
+        total += node->value;
+    return total;
+}
+
+int main() {
+    unlink(HEAP_PATH);
+    unlink(JOURNAL_PATH);
+
+    RcdPersist* heap = rcd_persist_open(HEAP_PATH, 1 << 20, NULL);
+    assert(heap != NULL);
+
+    List* list = (List*)rcd_persist_root(heap, "list", sizeof(List));
+    assert(list && list->head == NULL);
+    for (int i = 1; i <= 1000; i++) {
+        Node* node = (Node*)rcd_persist_alloc(heap, sizeof(Node));
+        assert(((size_t)node & 15) == 0);
+        node->value = i;
+        node->next = list->head;
+        list->head = node;
+        list->count++;
+    }
+    rcd_persist_free(heap, rcd_persist_alloc(heap, 100));
+    assert(rcd_persist_close(heap) == 0);
+
+    // The list is back at the same address, without any loading
+    heap = rcd_persist_open(HEAP_PATH, 0, NULL);
+    assert(heap != NULL);
+    assert(rcd_persist_root(heap, "list", 0) == list);
+    assert(list->count == 1000 && sum(list) == 500500);
+
+    int blocks = 0;
+    rcd_persist_for_each(heap, count_blocks, &blocks);
+    assert(blocks == 1001);
+
+    // Writes made after the last checkpoint are lost in a crash
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        list->head->value = 0;
+        assert(rcd_persist_checkpoint(heap) == 0);
+        list->head->next->value = 0;
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+    assert(rcd_persist_close(heap) == 0);
+
+    heap = rcd_persist_open(HEAP_PATH, 0, NULL);
+    assert(heap != NULL);
+    assert(list->head->value == 0 && list->head->next->value == 999);
+    assert(rcd_persist_close(heap) == 0);
+
+    // A journal whose header was never written is discarded
+    FILE* torn = fopen(JOURNAL_PATH, "wb");
+    fwrite("garbage", 1, 7, torn);
+    fclose(torn);
+    heap = rcd_persist_open(HEAP_PATH, 0, NULL);
+    assert(heap && sum(list) == 500500 - 1000);
+
+    printf("list->count: %d\n", list->count);
+    rcd_persist_close(heap);
+}
@@ -0,0 +1,42 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/lib.h"
+
+
+typedef struct {
+    double x, y, z;
+    int id;
+} Particle;
+
+int main() {
+    RcdPool* pool = rcd_pool_create(sizeof(Particle));
+    assert(pool != NULL);
+
+    Particle* particles[10000];
+    for (int i = 0; i < 10000; i++) {
+        particles[i] = (Particle*)rcd_pool_get(pool);
+        assert(((size_t)particles[i] & 15) == 0);
+        particles[i]->id = i;
+    }
+    for (int i = 0; i < 10000; i++)
+        assert(particles[i]->id == i);
+
+    // Released objects are reused first
+    rcd_pool_put(pool, particles[42]);
+    rcd_pool_put(pool, particles[7]);
+    assert(rcd_pool_get(pool) == particles[7]);
+    assert(rcd_pool_get(pool) == particles[42]);
+
+    printf("particles[9999].id: %d\n", particles[9999]->id);
+    rcd_pool_destroy(pool);
+
+    // Pools left alive are reclaimed by quit()
+    RcdPool* small = rcd_pool_create(1);
+    for (int i = 0; i < 1000; i++)
+        rcd_pool_get(small);
+
+    RcdPool* dropped = rcd_pool_create(64);
+    rcd_pool_get(dropped);
+    drop(dropped);
+}
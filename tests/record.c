@@ -0,0 +1,57 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib.h"
+#include "../src/record.h"
+
+
+int main() {
+    const char* path = "target/tests/record.bin";
+
+    RcdConfig config = rcd_config_from_env();
+    config.record_path = path;
+    assert(rcd_init(&config) == 0);
+
+    int* x = (int*)alloc(sizeof(int));       // id 0
+    int* y = (int*)alloc(300);               // id 1
+    int* z = (int*)copy(x, sizeof(int));     // id 2
+    y = (int*)resize(y, 600);
+    drop(x);
+    drop(z);
+    drop(y);
+    quit();
+
+    // The file is flushed when recording stops
+    rcd_init(NULL);
+    FILE* file = fopen(path, "rb");
+    assert(file != NULL);
+
+    char magic[RECORD_MAGIC_SIZE];
+    assert(fread(magic, 1, RECORD_MAGIC_SIZE, file) == RECORD_MAGIC_SIZE);
+    assert(memcmp(magic, RECORD_MAGIC, RECORD_MAGIC_SIZE) == 0);
+
+    uint64_t expected[][3] = {
+        { RECORD_ALLOC, sizeof(int) },
+        { RECORD_ALLOC, 300 },
+        { RECORD_COPY, 2, sizeof(int) },
+        { RECORD_RESIZE, 2, 600 },
+        { RECORD_DROP, 3 },
+        { RECORD_DROP, 1 },
+        { RECORD_DROP, 2 },
+    };
+    int fields[] = { 0, 1, 1, 2, 2, 1 };
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        assert(fgetc(file) == (int)expected[i][0]);
+        for (int field = 0; field < fields[expected[i][0]]; field++) {
+            uint64_t value;
+            assert(record_read_varint(file, &value) == 0);
+            assert(value == expected[i][field + 1]);
+        }
+    }
+    assert(fgetc(file) == EOF);
+    fclose(file);
+
+    printf("%zu operations recorded\n", sizeof(expected) / sizeof(expected[0]));
+}
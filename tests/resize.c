@@ -1,3 +1,6 @@
+#include <assert.h>
+#include <stdio.h>
+
 #include "../src/lib.h"
 
 
@@ -25,5 +28,11 @@ int main() {
     }
     printf("\n");
 
+    // Like realloc(), a zero size frees the block, quit() must not free it again
+    int* block = (int*)alloc(sizeof(int) * 1024);
+    assert(resize(block, 0) == NULL);
+    assert(!rcd_owner(block, NULL, NULL));
+    quit();
+
     return 0;
 }
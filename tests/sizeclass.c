@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib.h"
+
+
+#define OBJECTS 2000
+
+static void* handed[OBJECTS];
+
+static void* allocate(void* arg) {
+    for (int i = 0; i < OBJECTS; i++)
+        handed[i] = rcd_alloc_auto(48);
+    return NULL;
+}
+
+int main() {
+    // The first alloc() of a thread arms its countdown
+    volatile size_t runtime = 24;
+    drop(alloc(runtime));
+
+    // Constant sizes are rounded up to their class
+    char* a = (char*)rcd_alloc_auto(24);
+    void* base;
+    size_t size;
+    assert(rcd_owner(a + 30, &base, &size) && base == a && size == 32);
+    assert((uintptr_t)a % 16 == 0);
+
+    // Only live objects have an owner, not the ones carved but never handed out
+    assert(!rcd_owner(a + 32, NULL, NULL));
+
+    // The last object dropped is the first one reused
+    drop(a);
+    assert(!rcd_owner(a, NULL, NULL));
+    assert(rcd_alloc_auto(24) == a);
+    assert(rcd_owner(a, NULL, NULL));
+
+    // Other sizes keep their recorded size
+    char* b = (char*)alloc(runtime);
+    assert(rcd_owner(b, &base, &size) && base == b && size == 24);
+    drop(b);
+
+    // copy() and resize() read the whole class, resize() recycles the object
+    memset(a, 7, 32);
+    char* c = (char*)copy(a, 64);
+    assert(c[31] == 7);
+    char* d = (char*)resize(a, 1000);
+    assert(d[0] == 7 && d[31] == 7);
+    assert(rcd_alloc_auto(24) == a);
+    drop(a);
+    drop(c);
+    drop(d);
+
+    // Objects dropped past the cache go back to the other threads
+    char* objects[OBJECTS];
+    for (int i = 0; i < OBJECTS; i++)
+        objects[i] = (char*)rcd_alloc_auto(64);
+    for (int i = 0; i < OBJECTS; i++)
+        drop(objects[i]);
+    for (int i = 0; i < OBJECTS; i++) {
+        objects[i] = (char*)rcd_alloc_auto(64);
+        assert(rcd_owner(objects[i], NULL, &size) && size == 64);
+    }
+    for (int i = 0; i < OBJECTS; i++)
+        drop(objects[i]);
+
+    // Objects allocated by a thread can be dropped by another one
+    pthread_t thread;
+    pthread_create(&thread, NULL, allocate, NULL);
+    pthread_join(thread, NULL);
+    for (int i = 0; i < OBJECTS; i++)
+        drop(handed[i]);
+    assert(rcd_alloc_auto(48) == handed[OBJECTS - 1]);
+
+    // A thread with a budget is charged the exact size
+    RcdBudget* budget = rcd_budget_create("classes", 0, 0, NULL, NULL);
+    assert(budget);
+    rcd_budget_set(budget);
+    char* charged = (char*)rcd_alloc_auto(24);
+    assert(rcd_budget_used(budget) == 24);
+    drop(charged);
+    rcd_budget_set(NULL);
+    rcd_budget_destroy(budget);
+
+    // quit() reclaims the objects along with the tracked blocks
+    quit();
+    drop(alloc(runtime));
+    char* fresh = (char*)rcd_alloc_auto(24);
+    assert(fresh == (char*)rcd_class_base + RCD_CLASS_REGION / RCD_CLASSES);
+
+    printf("size classes: %d\n", RCD_CLASSES);
+}
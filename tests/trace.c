@@ -0,0 +1,52 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../src/lib.h"
+#include "../src/trace.h"
+
+
+int main() {
+    const char* path = "target/tests/trace.bin";
+
+    RcdConfig config = rcd_config_from_env();
+    config.trace_path = path;
+    config.trace_size = 1 << 20;
+    assert(rcd_init(&config) == 0);
+
+    int* x = (int*)alloc(sizeof(int));
+    uintptr_t x_addr = (uintptr_t)x;
+    int* y = (int*)copy(x, sizeof(int));
+    y = (int*)resize(y, sizeof(int) * 2);
+    drop(x);
+
+    // Events are written straight to the mapped file
+    FILE* file = fopen(path, "rb");
+    assert(file != NULL);
+
+    TraceHeader header;
+    assert(fread(&header, sizeof(header), 1, file) == 1);
+    assert(memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0);
+    assert(header.cursor == TRACE_CHUNK);
+
+    TraceEvent events[4];
+    assert(fread(events, sizeof(TraceEvent), 4, file) == 4);
+    fclose(file);
+
+    assert(events[0].op == TRACE_ALLOC && events[0].ptr == x_addr);
+    assert(events[1].op == TRACE_COPY && events[1].from == x_addr);
+    assert(events[2].op == TRACE_RESIZE && events[2].ptr == (uintptr_t)y && events[2].size == sizeof(int) * 2);
+    assert(events[3].op == TRACE_DROP && events[3].size == sizeof(int));
+    for (int i = 1; i < 4; i++)
+        assert(events[i].tsc >= events[i - 1].tsc);
+
+    // quit() unmaps the ring
+    quit();
+    char line[512];
+    FILE* maps = fopen("/proc/self/maps", "r");
+    while (fgets(line, sizeof(line), maps))
+        assert(strstr(line, "trace.bin") == NULL);
+    fclose(maps);
+
+    printf("tsc_per_us: %.1f\n", header.tsc_per_us);
+}
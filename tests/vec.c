@@ -0,0 +1,49 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "../src/vec.h"
+
+
+typedef RcdVec(int) IntVec;
+
+int main() {
+    IntVec v;
+    rcd_vec_init(&v);
+
+    int failed = 0;
+    for (int i = 0; i < 100000; i++)
+        failed |= rcd_vec_push(&v, i);
+    assert(failed == 0);
+    assert(v.len == 100000);
+    assert(v.cap >= v.len);
+    for (int i = 0; i < 100000; i++)
+        assert(v.data[i] == i);
+
+    // The whole array is a single tracked block
+    void* base;
+    size_t size;
+    assert(rcd_owner(&v.data[500], &base, &size));
+    assert(base == v.data && size == v.cap * sizeof(int));
+
+    int tail[] = { -1, -2, -3 };
+    assert(rcd_vec_append(&v, tail, 3) == 0);
+    assert(rcd_vec_pop(&v) == -3);
+    assert(v.len == 100002);
+
+    assert(rcd_vec_shrink_to_fit(&v) == 0);
+    assert(v.cap == v.len);
+    assert(v.data[99999] == 99999 && v.data[100001] == -2);
+
+    assert(rcd_vec_reserve(&v, 1 << 20) == 0);
+    assert(v.cap == 1 << 20);
+
+    printf("v.len: %zu, v.cap: %zu\n", v.len, v.cap);
+    rcd_vec_free(&v);
+    assert(v.data == NULL && v.len == 0);
+
+    // Vectors left alive are reclaimed by quit()
+    IntVec leaked;
+    rcd_vec_init(&leaked);
+    failed = rcd_vec_push(&leaked, 1);
+    assert(failed == 0);
+}
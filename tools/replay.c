@@ -0,0 +1,278 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/lib.h"
+#include "../src/record.h"
+
+/*
+ * Replays a recording made with RCD_RECORD against each allocator backend and
+ * reports its throughput, peak RSS growth and latency percentiles. Every
+ * backend runs in its own process so that their heaps don't interfere.
+ *
+ * Usage: replay <recording> [backend...]
+ */
+
+/**
+ * @struct ReplayOp
+ * @brief A decoded operation, with absolute logical ids.
+ * Size: 24 bytes
+ */
+typedef struct {
+    uint32_t op;
+    uint32_t id;
+    uint32_t from;
+    uint64_t size;
+} ReplayOp;
+
+/**
+ * @struct Backend
+ * @brief An allocator the recording can be replayed against.
+ *
+ * `copy` gets the size of the source block for the allocators that don't
+ * record it themselves.
+ */
+typedef struct {
+    const char* name;
+    void* (*alloc)(size_t size);
+    void (*drop)(void* ptr);
+    void* (*copy)(void* ptr, size_t old_size, size_t size);
+    void* (*resize)(void* ptr, size_t size);
+} Backend;
+
+static void* rcd_alloc(size_t size) {
+    return alloc(size);
+}
+
+static void rcd_drop(void* ptr) {
+    drop(ptr);
+}
+
+static void* rcd_copy(void* ptr, size_t old_size, size_t size) {
+    return copy(ptr, size);
+}
+
+static void* malloc_copy(void* ptr, size_t old_size, size_t size) {
+    void* new_ptr = malloc(size);
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    return new_ptr;
+}
+
+static const Backend backends[] = {
+    { "rcd", rcd_alloc, rcd_drop, rcd_copy, resize },
+    { "malloc", malloc, free, malloc_copy, realloc },
+};
+
+#define BACKENDS (sizeof(backends) / sizeof(backends[0]))
+
+static uint64_t now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+// Decodes a whole recording, ids are resolved from the distances
+static ReplayOp* load(const char* path, size_t* count, uint32_t* ids) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    char magic[RECORD_MAGIC_SIZE];
+    if (fread(magic, 1, RECORD_MAGIC_SIZE, file) != RECORD_MAGIC_SIZE ||
+        memcmp(magic, RECORD_MAGIC, RECORD_MAGIC_SIZE) != 0) {
+        fprintf(stderr, "%s: not a rcd recording\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    size_t capacity = 1024;
+    ReplayOp* ops = (ReplayOp*)malloc(capacity * sizeof(ReplayOp));
+    uint32_t next_id = 0;
+    int op;
+
+    *count = 0;
+    while ((op = fgetc(file)) != EOF) {
+        ReplayOp decoded = { .op = (uint32_t)op };
+        uint64_t distance = 0;
+        int failed = 0;
+
+        switch (op) {
+            case RECORD_ALLOC:
+                failed = record_read_varint(file, &decoded.size);
+                decoded.id = next_id++;
+                break;
+            case RECORD_DROP:
+                failed = record_read_varint(file, &distance);
+                decoded.id = next_id - (uint32_t)distance;
+                break;
+            case RECORD_COPY:
+                failed = record_read_varint(file, &distance) || record_read_varint(file, &decoded.size);
+                decoded.from = next_id - (uint32_t)distance;
+                decoded.id = next_id++;
+                break;
+            case RECORD_RESIZE:
+                failed = record_read_varint(file, &distance) || record_read_varint(file, &decoded.size);
+                decoded.id = next_id - (uint32_t)distance;
+                break;
+            default:
+                failed = 1;
+        }
+        if (failed || decoded.id >= next_id || decoded.from >= next_id) {
+            fprintf(stderr, "%s: corrupted at operation %zu\n", path, *count);
+            break;
+        }
+
+        if (*count == capacity) {
+            capacity *= 2;
+            ops = (ReplayOp*)realloc(ops, capacity * sizeof(ReplayOp));
+        }
+        ops[(*count)++] = decoded;
+    }
+
+    fclose(file);
+    *ids = next_id;
+    return ops;
+}
+
+static inline void execute(const Backend* backend, const ReplayOp* op, void** blocks, uint64_t* sizes) {
+    switch (op->op) {
+        case RECORD_ALLOC:
+            blocks[op->id] = backend->alloc(op->size);
+            break;
+        case RECORD_DROP:
+            backend->drop(blocks[op->id]);
+            blocks[op->id] = NULL;
+            break;
+        case RECORD_COPY:
+            blocks[op->id] = backend->copy(blocks[op->from], sizes[op->from], op->size);
+            break;
+        case RECORD_RESIZE:
+            blocks[op->id] = backend->resize(blocks[op->id], op->size);
+            break;
+    }
+    sizes[op->id] = op->size;
+}
+
+static void release(const Backend* backend, void** blocks, uint32_t ids) {
+    for (uint32_t id = 0; id < ids; id++) {
+        if (blocks[id])
+            backend->drop(blocks[id]);
+        blocks[id] = NULL;
+    }
+}
+
+static int compare_latencies(const void* a, const void* b) {
+    uint32_t la = *(const uint32_t*)a;
+    uint32_t lb = *(const uint32_t*)b;
+    return (la > lb) - (la < lb);
+}
+
+static long peak_rss_kib() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * The first pass measures throughput and peak RSS, the second one times
+ * every operation, minus the cost of reading the clock.
+ */
+static void run(const Backend* backend, const ReplayOp* ops, size_t count, uint32_t ids) {
+    void** blocks = (void**)malloc(ids * sizeof(void*));
+    uint64_t* sizes = (uint64_t*)malloc(ids * sizeof(uint64_t));
+    uint32_t* latencies = (uint32_t*)malloc(count * sizeof(uint32_t));
+
+    // Touched before measuring, so that only the heap shows in the RSS
+    memset(blocks, 0, ids * sizeof(void*));
+    memset(sizes, 0, ids * sizeof(uint64_t));
+    long rss_start = peak_rss_kib();
+
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < count; i++)
+        execute(backend, &ops[i], blocks, sizes);
+    uint64_t elapsed = now_ns() - start;
+    long rss_peak = peak_rss_kib();
+    release(backend, blocks, ids);
+
+    uint64_t clock_cost = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t before = now_ns();
+        uint64_t after = now_ns();
+        if (after - before < clock_cost)
+            clock_cost = after - before;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t before = now_ns();
+        execute(backend, &ops[i], blocks, sizes);
+        uint64_t latency = now_ns() - before;
+        latencies[i] = latency > clock_cost ?
+            (uint32_t)(latency - clock_cost) : 0;
+    }
+    release(backend, blocks, ids);
+
+    qsort(latencies, count, sizeof(uint32_t), compare_latencies);
+    printf("%-8s %10.2f %12.1f %8u %8u %8u %10u\n",
+        backend->name,
+        elapsed ? (double)count * 1000.0 / (double)elapsed : 0.0,
+        (double)(rss_peak - rss_start) / 1024.0,
+        latencies[count / 2],
+        latencies[count - 1 - count / 100],
+        latencies[count - 1 - count / 1000],
+        latencies[count - 1]);
+    fflush(stdout);
+
+    free(latencies);
+    free(sizes);
+    free(blocks);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <recording> [backend...]\n\nBackends:", argv[0]);
+        for (size_t i = 0; i < BACKENDS; i++)
+            fprintf(stderr, " %s", backends[i].name);
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    size_t count;
+    uint32_t ids;
+    ReplayOp* ops = load(argv[1], &count, &ids);
+    if (ops == NULL)
+        return 1;
+    if (count == 0) {
+        fprintf(stderr, "%s: empty recording\n", argv[1]);
+        return 1;
+    }
+
+    printf("%zu operations, %u blocks\n\n", count, ids);
+    printf("%-8s %10s %12s %8s %8s %8s %10s\n",
+        "backend", "Mops/s", "RSS +MiB", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    fflush(stdout);
+
+    for (size_t i = 0; i < BACKENDS; i++) {
+        int selected = argc == 2;
+        for (int arg = 2; arg < argc; arg++)
+            selected |= strcmp(argv[arg], backends[i].name) == 0;
+        if (!selected)
+            continue;
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            run(&backends[i], ops, count, ids);
+            exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+
+    free(ops);
+    return 0;
+}
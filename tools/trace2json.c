@@ -0,0 +1,110 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/ptrmap.h"
+#include "../src/trace.h"
+
+/*
+ * Converts a trace written with RCD_TRACE to the Chrome trace event format,
+ * readable by chrome://tracing and https://ui.perfetto.dev.
+ *
+ * Usage: trace2json <trace> [output.json]
+ */
+
+static const char* op_names[] = { "none", "alloc", "drop", "copy", "resize" };
+
+static int compare_events(const void* a, const void* b) {
+    uint64_t ta = ((const TraceEvent*)a)->tsc;
+    uint64_t tb = ((const TraceEvent*)b)->tsc;
+    return (ta > tb) - (ta < tb);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace> [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* input = fopen(argv[1], "rb");
+    if (input == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, input) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION || header.event_size != sizeof(TraceEvent)) {
+        fprintf(stderr, "%s: not a rcd trace\n", argv[1]);
+        return 1;
+    }
+
+    TraceEvent* events = (TraceEvent*)malloc(header.capacity * sizeof(TraceEvent));
+    size_t count = fread(events, sizeof(TraceEvent), header.capacity, input);
+    fclose(input);
+
+    // Drop the slots that were claimed but never written
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (events[i].op != TRACE_NONE && events[i].op <= TRACE_RESIZE)
+            events[kept++] = events[i];
+    }
+    qsort(events, kept, sizeof(TraceEvent), compare_events);
+
+    FILE* output = argc == 3 ?
+        fopen(argv[2], "w") : stdout;
+    if (output == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    // Sizes of the live blocks, to follow the heap size through resizes
+    PtrMap sizes;
+    ptrmap_init(&sizes, 1024);
+
+    double tsc_per_us = header.tsc_per_us > 0 ?
+        header.tsc_per_us : 1000.0;
+    int64_t live = 0;
+
+    fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < kept; i++) {
+        TraceEvent* event = &events[i];
+        double ts = (double)(int64_t)(event->tsc - header.tsc_start) / tsc_per_us;
+
+        switch (event->op) {
+            case TRACE_ALLOC:
+            case TRACE_COPY:
+                ptrmap_put(&sizes, event->ptr, event->size);
+                live += (int64_t)event->size;
+                break;
+            case TRACE_DROP:
+                ptrmap_take(&sizes, event->ptr, NULL);
+                live -= (int64_t)event->size;
+                break;
+            case TRACE_RESIZE: {
+                uint64_t old_size = 0;
+                ptrmap_take(&sizes, event->from, &old_size);
+                ptrmap_put(&sizes, event->ptr, event->size);
+                live += (int64_t)event->size - (int64_t)old_size;
+                break;
+            }
+        }
+
+        fprintf(output,
+            "{\"name\":\"%s\",\"cat\":\"rcd\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%" PRIu32 ","
+            "\"args\":{\"ptr\":\"0x%" PRIx64 "\",\"from\":\"0x%" PRIx64 "\",\"size\":%" PRIu64 "}},\n",
+            op_names[event->op], ts, event->tid, event->ptr, event->from, event->size);
+        fprintf(output,
+            "{\"name\":\"live bytes\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"bytes\":%" PRId64 "}}%s\n",
+            ts, live, i + 1 < kept ? "," : "");
+    }
+    fprintf(output, "]}\n");
+
+    if (output != stdout)
+        fclose(output);
+    ptrmap_free(&sizes);
+    free(events);
+    return 0;
+}